@@ -10,7 +10,65 @@
 #include "postgres.h"
 
 #include "fmgr.h"
+#include "funcapi.h"
 #include "libpq/pqformat.h"		/* needed for send/recv functions */
+#include "access/brin_internal.h"
+#include "access/brin_tuple.h"
+#include "access/genam.h"
+#include "access/gin.h"
+#include "access/gist.h"
+#include "access/hash.h"
+#include "access/htup_details.h"
+#if PG_VERSION_NUM >= 130000
+#include "access/reloptions.h"
+#endif
+#include "access/relscan.h"
+#include "access/skey.h"
+#include "access/spgist.h"
+#include "access/stratnum.h"
+#if PG_VERSION_NUM >= 130000
+#include "access/detoast.h"
+#else
+#include "access/tuptoaster.h"
+#endif
+#include "catalog/pg_am.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_opfamily.h"
+#include "catalog/pg_operator.h"
+#include "catalog/pg_statistic.h"
+#include "commands/explain.h"
+#include "commands/vacuum.h"
+#include "executor/executor.h"
+#include "catalog/pg_type.h"
+#include "lib/hyperloglog.h"
+#include "nodes/extensible.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/supportnodes.h"
+#include "optimizer/cost.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
+#include "optimizer/planner.h"
+#include "optimizer/restrictinfo.h"
+#include "parser/parsetree.h"
+#include "parser/parse_func.h"
+#include "port/pg_bitutils.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/float.h"
+#include "utils/fmgroids.h"
+#include "utils/geo_decls.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/rangetypes.h"
+#include "utils/rel.h"
+#include "utils/selfuncs.h"
+#include "utils/sortsupport.h"
+#include "utils/syscache.h"
+#include "utils/typcache.h"
 
 #include <regex.h>
 #include <string.h>
@@ -20,6 +78,17 @@
 
 PG_MODULE_MAGIC;
 
+// strategy numbers of the intset operators in the index operator classes
+#define INTSET_OVERLAP_STRATEGY		3	// ?|
+#define INTSET_EQUAL_STRATEGY		6	// =
+#define INTSET_CONTAINS_STRATEGY	7	// >@
+#define INTSET_CONTAINED_STRATEGY	8	// @<
+#define INTSET_HAS_STRATEGY			9	// ? (intset, integer)
+#define INTSET_OVERLAP_RANGE_STRATEGY	10	// &&> (intset, int4range)
+#define INTSET_SPAN_WITHIN_STRATEGY		11	// <@ (intset, int4range)
+#define INTSET_SPAN_OVERLAP_STRATEGY	12	// <&> (intset, int4range)
+#define INTSET_JACCARD_STRATEGY		15	// <%> (ordering)
+
 struct intSet
 {
 	uint32 size;
@@ -27,6 +96,10 @@ struct intSet
 };
 typedef struct intSet intSet;
 
+// a set argument, detoasted without a copy where it can be (see detoastSet)
+#define DatumGetIntSetP(X)		detoastSet(X)
+#define PG_GETARG_INTSET_P(n)	DatumGetIntSetP(PG_GETARG_DATUM(n))
+
 // helper struct
 struct treeNode {
     uint32_t data;
@@ -35,6 +108,271 @@ struct treeNode {
 };
 typedef struct treeNode *TreeNode;
 
+// state kept between the calls of intset_elements
+struct elementsState {
+	intSet *set;	// the set being walked
+	uint32 wrap;	// the first element over PG_INT32_MAX (see intWrap)
+	uint32 next;	// position of the next element to return
+	uint32 end;		// one past the position of the last element to return
+};
+typedef struct elementsState elementsState;
+
+// state kept by the sortsupport of intset while building abbreviated keys
+struct abbrevState {
+	int64 input_count;				// number of keys built so far
+	bool estimating;				// still checking if abbreviation pays off
+	hyperLogLogState abbr_card;		// cardinality estimator of the keys
+};
+typedef struct abbrevState abbrevState;
+
+// the key of the GiST index on intset
+struct intSetGistKey {
+	int32 vl_len_;		// varlena header (do not touch directly!)
+	int32 flag;			// what data holds, one of the GKEY_* flags
+	uint32 mincard;		// the smallest and largest number of elements
+	uint32 maxcard;		// of the sets under this key
+	char data[FLEXIBLE_ARRAY_MEMBER];
+};
+typedef struct intSetGistKey intSetGistKey;
+
+#define GKEY_EXACT		0x01	// data is the nums[] of a leaf set
+#define GKEY_SIGN		0x02	// data is a signature of siglen bytes
+#define GKEY_ALLTRUE	0x04	// a signature with every bit set, no data
+#define GKEY_HDRSZ		offsetof(intSetGistKey, data)
+
+// numsOverlap() gallops through the larger set when it is this many times
+// bigger than the other one, instead of merging the two
+#define GALLOP_RATIO	16
+
+// leaf sets with at most this many elements are kept as they are
+#define GIST_EXACT_MAX	512
+
+// signature length in bytes, can be changed with the siglen option
+#define SIGLEN_DEFAULT	(63 * 4)
+#define SIGLEN_MAX		GISTMaxIndexKeySize
+#if PG_VERSION_NUM >= 130000
+struct intSetGistOptions {
+	int32 vl_len_;		// varlena header (do not touch directly!)
+	int siglen;			// signature length in bytes
+};
+typedef struct intSetGistOptions intSetGistOptions;
+#define GET_SIGLEN()	(PG_HAS_OPCLASS_OPTIONS() ? \
+						 ((intSetGistOptions *) PG_GET_OPCLASS_OPTIONS())->siglen : \
+						 SIGLEN_DEFAULT)
+#else
+#define GET_SIGLEN()	SIGLEN_DEFAULT
+#endif
+
+// number of low bits dropped from an element to get its bucket in
+// intset_gin_bucket_ops, can be changed with the bucket_bits option
+#define BUCKET_BITS_DEFAULT	8
+#define BUCKET_BITS_MAX		31
+#if PG_VERSION_NUM >= 130000
+struct intSetGinOptions {
+	int32 vl_len_;		// varlena header (do not touch directly!)
+	int bucket_bits;	// number of low bits dropped from an element
+};
+typedef struct intSetGinOptions intSetGinOptions;
+#define GET_BUCKET_BITS()	(PG_HAS_OPCLASS_OPTIONS() ? \
+							 ((intSetGinOptions *) PG_GET_OPCLASS_OPTIONS())->bucket_bits : \
+							 BUCKET_BITS_DEFAULT)
+#else
+#define GET_BUCKET_BITS()	BUCKET_BITS_DEFAULT
+#endif
+
+// the BRIN summary of a block range is the [min, max] span of all the
+// elements in it and a bloom filter of BLOOM_BYTES bytes over them
+#define BRIN_MIN		0
+#define BRIN_MAX		1
+#define BRIN_BLOOM		2
+#define BLOOM_BYTES		256
+#define BLOOM_HASHES	3
+
+// the selectivity used when there are no statistics to go by
+#define DEFAULT_CONTAIN_SEL	0.005
+
+// what the statistics of a column say about its sets: the most common
+// elements (in ascending order) with the fraction of the rows that have
+// them, and a histogram of the number of elements in a set
+// (the same layout as STATISTIC_KIND_MCELEM and DECHIST of arrays)
+struct intSetStats {
+	float8 nullfrac;		// fraction of the rows that are null
+	AttStatsSlot mcelem;	// values are the elements (int4), numbers are
+							// their frequencies, then min, max & null freq
+	bool hasMcelem;
+	uint32 nmce;			// number of most common elements
+	float4 minfreq;			// the frequency of the least common of them
+	AttStatsSlot dechist;	// numbers are the histogram, then the average
+							// and the number of distinct elements
+	bool hasDechist;
+	uint32 nhist;			// number of histogram entries
+	float4 avgcount;		// average number of elements in a set
+	float4 ndistinct;		// number of distinct elements
+	float8 restfreq;		// frequency of an element that is not one of the
+							// most common ones
+};
+typedef struct intSetStats intSetStats;
+
+// at most this many elements of a set are counted by ANALYZE, a larger set
+// is sampled at an even stride and each element counted stands for stride
+// of them
+#define ANALYZE_MAX_ELEMS	1024
+
+// an element ANALYZE keeps track of for Lossy Counting
+struct elemTrack {
+	uint32 elem;		// the hash key, must be first
+	int frequency;		// number of rows it was seen in (so far)
+	int delta;			// the most it can have been missed by
+};
+typedef struct elemTrack elemTrack;
+
+// the standard compute_stats of the type, called before our own
+struct analyzeExtra {
+	AnalyzeAttrComputeStatsFunc stdComputeStats;
+	void *stdExtraData;
+};
+typedef struct analyzeExtra analyzeExtra;
+
+// the state of an IntSet Index Probe scan (see Custom scan below)
+struct intSetScanState {
+	CustomScanState css;
+	Relation index;			// the btree index on the integer column
+	IndexScanDesc scan;		// the index scan, NULL until the first probe
+	ExprState *setExpr;		// the set of the clause
+	intSet *set;			// its value, NULL until the scan starts
+	ScanKeyData key;		// column = the element being probed
+	uint32 wrap;			// the first element over PG_INT32_MAX, 0 if none
+	uint32 pos;				// how many elements from wrap on that is
+	bool started;
+};
+typedef struct intSetScanState intSetScanState;
+
+// a set argument of a function, prepared once and kept in fn_extra for all
+// the calls of an expression when the argument is a constant or a parameter
+struct probeSet {
+	bool isConst;			// is the argument a Const (it never changes then)
+	Pointer rawptr;			// the argument it was made from, as passed
+	Pointer raw;			// a copy of that, NULL for a Const
+	Size rawsize;			// its size, as passed
+	uint32 sample;			// rawSample() of it
+	intSet *set;			// the detoasted set
+	bool bitmapTried;		// has a bitmap been considered yet
+	uint64 *bitmap;			// a bit per number from min on, NULL if too sparse
+	uint32 min;
+	uint32 nbits;
+};
+typedef struct probeSet probeSet;
+
+// a bitmap is built for a set whose span has at most this many numbers per
+// element (so the bitmap is no larger than the set itself)
+#define BITMAP_DENSITY	32
+
+// the number of words of a parameter rawSample() looks at
+#define RAW_SAMPLES		16
+
+// how the cost of a function grows with the number of elements it is given
+// (every function intset_support is attached to should be in costClasses, one
+// that isn't is costed as a linear one)
+#define COST_CONSTANT	0	// it doesn't
+#define COST_SEARCH		1	// a binary search
+#define COST_LINEAR		2	// a pass over all of them
+
+// the cost of one element in a pass, as a fraction of cpu_operator_cost
+#define ELEMENT_COST	0.1
+
+// a constant set of at most this many elements is given to the partition
+// pruner as = ANY of its elements, a larger one as its span
+#define PRUNE_ARRAY_SIZE	64
+
+// the number of elements of a set nothing is known about
+#define DEFAULT_SET_SIZE	10
+
+struct costClass {
+	const char *name;	// the SQL name of the function
+	int growth;			// one of the COST_* above
+};
+typedef struct costClass costClass;
+
+static const costClass costClasses[] = {
+	{"intset_cardinality", COST_CONSTANT},
+	{"intset_min", COST_CONSTANT},
+	{"intset_max", COST_CONSTANT},
+	{"intset_within_range", COST_CONSTANT},
+	{"intset_span_overlaps_range", COST_CONSTANT},
+	{"intset_contains", COST_SEARCH},
+	{"intset_has", COST_SEARCH},
+	{"intset_overlaps_range", COST_SEARCH},
+	{"intset_next", COST_SEARCH},
+	{"intset_prev", COST_SEARCH},
+	{"intset_union", COST_LINEAR},
+	{"intset_intersectn", COST_LINEAR},
+	{"intset_union_all", COST_LINEAR},
+	{"intset_intersect_all", COST_LINEAR},
+	{"intset_disjunctn", COST_LINEAR},
+	{"intset_diff", COST_LINEAR},
+	{"intset_contain_all", COST_LINEAR},
+	{"intset_contain_only", COST_LINEAR},
+	{"intset_overlaps", COST_LINEAR},
+	{"intset_equal", COST_LINEAR},
+	{"intset_not_equal", COST_LINEAR},
+	{"intset_cmp", COST_LINEAR},
+	{"intset_lt", COST_LINEAR},
+	{"intset_le", COST_LINEAR},
+	{"intset_gt", COST_LINEAR},
+	{"intset_ge", COST_LINEAR},
+	{"intset_hash", COST_LINEAR},
+	{"intset_hash_extended", COST_LINEAR},
+	{"intset_jaccard_distance", COST_LINEAR},
+	{"intset_elements", COST_LINEAR},
+	{"intset_add", COST_LINEAR},
+	{"intset_remove", COST_LINEAR},
+	{"intset_add_all", COST_LINEAR},
+	{"intset_remove_all", COST_LINEAR},
+	{"intset_add_range", COST_LINEAR},
+	{"intset_remove_range", COST_LINEAR},
+	{"intset_flip_range", COST_LINEAR},
+	{NULL, COST_LINEAR}
+};
+
+// the functions callCost has already looked up in costClasses, by OID (so the
+// name of each one is only looked up once per backend)
+struct costMemo {
+	Oid funcid;
+	int growth;
+};
+typedef struct costMemo costMemo;
+
+#define COST_MEMO_SIZE	64
+
+static costMemo costMemos[COST_MEMO_SIZE];
+static int costMemoCount = 0;
+
+// the index operator a call of a function turns into, by the argument of the
+// call that is the indexed set
+struct indexOperator {
+	const char *name;	// the SQL name of the function
+	int arg;			// the argument that is the indexed set
+	int strategy;		// the operator, with that set on its left
+};
+typedef struct indexOperator indexOperator;
+
+static const indexOperator indexOperators[] = {
+	{"intset_contains", 1, INTSET_HAS_STRATEGY},
+	{"intset_has", 0, INTSET_HAS_STRATEGY},
+	{"intset_contain_all", 0, INTSET_CONTAINS_STRATEGY},
+	{"intset_contain_all", 1, INTSET_CONTAINED_STRATEGY},
+	{"intset_contain_only", 0, INTSET_CONTAINED_STRATEGY},
+	{"intset_contain_only", 1, INTSET_CONTAINS_STRATEGY},
+	{"intset_overlaps", 0, INTSET_OVERLAP_STRATEGY},
+	{"intset_overlaps", 1, INTSET_OVERLAP_STRATEGY},
+	{"intset_equal", 0, INTSET_EQUAL_STRATEGY},
+	{"intset_equal", 1, INTSET_EQUAL_STRATEGY},
+	{"intset_overlaps_range", 0, INTSET_OVERLAP_RANGE_STRATEGY},
+	{"intset_within_range", 0, INTSET_SPAN_WITHIN_STRATEGY},
+	{"intset_span_overlaps_range", 0, INTSET_SPAN_OVERLAP_STRATEGY},
+	{NULL, 0, InvalidStrategy}
+};
+
 /*
     ---------------- Helper Function Interfaces ----------------
 */
@@ -55,7 +393,114 @@ uint32_t treeHeight(TreeNode root);
 */
 int treeToArr(TreeNode root, uint32_t arr[], int i);
 bool numsEqual(uint32 *a, uint32 *b, uint32 size);
+int numsCompare(uint32 *a, uint32 asize, uint32 *b, uint32 bsize);
 bool binarySearch(uint32* n, uint32 low, uint32 high, uint32 target);
+bool numsOverlap(uint32 *a, uint32 asize, uint32 *b, uint32 bsize);
+bool numsContain(uint32 *a, uint32 asize, uint32 *b, uint32 bsize);
+uint32 numsIntersectSize(uint32 *a, uint32 asize, uint32 *b, uint32 bsize);
+double jaccardDistance(uint32 *a, uint32 asize, uint32 *b, uint32 bsize);
+uint32 lowerBound(uint32 *n, uint32 size, uint32 target);
+uint32 upperBound(uint32 *n, uint32 size, uint32 target);
+uint32 gallopBound(uint32 *n, uint32 from, uint32 size, uint32 target);
+intSet *newIntSet(uint32 *nums, uint32 size);
+bool rangeToBounds(RangeType *r, uint32 *lo, uint32 *hi);
+void numsSpan(uint32 *nums, uint32 size, float8 *min, float8 *max);
+bool numsIntSpan(uint32 *nums, uint32 size, int32 *lo, int32 *hi);
+uint32 intWrap(uint32 *nums, uint32 size);
+uint32 intLowerBound(uint32 *nums, uint32 size, int32 x);
+uint32 intUpperBound(uint32 *nums, uint32 size, int32 x);
+intSet *intSlice(uint32 *nums, uint32 size, uint32 from, uint32 to);
+uint32 sliceElement(Datum d, uint32 i);
+bool spanQuery(RangeType *r, StrategyNumber strategy, float8 *lo, float8 *hi);
+bool spanConsistent(float8 min, float8 max, float8 lo, float8 hi, StrategyNumber strategy);
+uint32 *arrayToNums(ArrayType *arr, uint32 *size);
+void radixSort(uint32 *arr, uint32 size);
+uint32 uniqueNums(uint32 *arr, uint32 size);
+uint32 mergeUnion(uint32 *a, uint32 asize, uint32 *b, uint32 bsize, uint32 *out);
+uint32 mergeDiff(uint32 *a, uint32 asize, uint32 *b, uint32 bsize, uint32 *out);
+uint32 mergeIntersect(uint32 *a, uint32 asize, uint32 *b, uint32 bsize, uint32 *out);
+intSet **arrayToSets(ArrayType *arr, int *n);
+intSet *setsUnion(intSet **sets, int n);
+intSet *setsIntersect(intSet **sets, int n);
+intSet *allocIntSet(uint64 size);
+intSet *setAddRange(intSet *a, uint32 lo, uint32 hi);
+intSet *setRemoveRange(intSet *a, uint32 lo, uint32 hi);
+intSet *setFlipRange(intSet *a, uint32 lo, uint32 hi);
+/*
+    ---------------- Selectivity operations ----------------
+*/
+float8 restrictSel(FunctionCallInfo fcinfo, StrategyNumber strategy, bool negate);
+float8 boundsSel(PlannerInfo *root, VariableStatData *vardata, Node *set, Oid nsp, int varRelid);
+void loadStats(VariableStatData *vardata, intSetStats *stats);
+void freeStats(intSetStats *stats);
+int mceIndex(intSetStats *stats, uint32 n);
+float8 elemFreq(intSetStats *stats, uint32 n);
+float8 cardFreq(intSetStats *stats, uint32 card);
+float8 numsSel(intSetStats *stats, uint32 *nums, uint32 size, StrategyNumber strategy);
+float8 joinSel(FunctionCallInfo fcinfo, StrategyNumber strategy, bool negate);
+float8 hasJoinSel(VariableStatData *intdata, intSetStats *stats);
+float8 overlapJoinSel(intSetStats *a, intSetStats *b);
+float8 containJoinSel(intSetStats *a, intSetStats *b);
+float8 cardJoinFreq(intSetStats *a, intSetStats *b);
+void pruneElements(HTAB *elements, int bucket);
+/*
+    ---------------- Planner operations ----------------
+*/
+List *callArgs(Node *node);
+float8 callCost(PlannerInfo *root, Oid funcid, List *args);
+int costGrowth(Oid funcid);
+float8 argSize(PlannerInfo *root, Node *arg, Oid settype);
+Oid setType(Oid funcid);
+List *indexCondition(SupportRequestIndexCondition *req);
+List *setIndexCondition(SupportRequestIndexCondition *req, const char *name, List *args);
+List *spanIndexCondition(SupportRequestIndexCondition *req, const char *name, List *args);
+Node *simplifyCall(PlannerInfo *root, FuncExpr *call);
+void pruneQuery(Query *query);
+Node *pruneMutator(Node *node, void *context);
+Node *pruneMembership(Query *query, Node *node);
+List *pruneConditions(Var *var, Node *set, Oid nsp);
+List *pruneBounds(Var *var, Node *set, Oid nsp);
+Node *simplifySetOperation(FuncExpr *call, const char *pairName, const char *allName, bool unite);
+List *setOperands(Node *node, Oid pairfunc, Oid allfunc, List *operands);
+Oid lookupSetFunction(Oid nsp, const char *name, Oid argtype, int nargs);
+bool isEmptySet(Node *node);
+bool probeClause(RelOptInfo *rel, RestrictInfo *rinfo, Var **var, Node **set);
+IndexOptInfo *probeIndex(RelOptInfo *rel, Var *var);
+void probeCost(PlannerInfo *root, RelOptInfo *rel, RestrictInfo *rinfo, IndexOptInfo *index,
+			   Node *set, Path *path);
+bool probeStart(intSetScanState *state);
+Datum probeKey(intSetScanState *state);
+/*
+    ---------------- GIN key operations ----------------
+*/
+Datum *ginNumsKeys(uint32 *nums, uint32 size, int shift, int32 *nentries);
+Datum *ginQueryKeys(FunctionCallInfo fcinfo, int shift);
+bool ginConsistent(bool *check, StrategyNumber strategy, int32 nkeys, bool *recheck);
+GinTernaryValue ginTriConsistent(GinTernaryValue *check, StrategyNumber strategy, int32 nkeys);
+/*
+    ---------------- Bloom filter operations ----------------
+*/
+bool bloomAdd(char *bloom, uint32 n);
+bool bloomMayContain(char *bloom, uint32 n);
+/*
+    ---------------- Signature operations ----------------
+*/
+void signAddNums(char *sign, int siglen, uint32 *nums, uint32 size);
+char *keySign(intSetGistKey *key, int siglen);
+intSetGistKey *makeExactKey(uint32 *nums, uint32 size);
+intSetGistKey *makeSignKey(char *sign, int siglen, uint32 mincard, uint32 maxcard);
+int hemdistSign(char *a, char *b, int siglen);
+void signUnion(char *dst, char *src, int siglen);
+/*
+    ---------------- Argument operations ----------------
+*/
+intSet *argSet(FunctionCallInfo fcinfo, int argno);
+probeSet *probeArg(FunctionCallInfo fcinfo, int argno, bool bitmap);
+bool probeStale(probeSet *p, Pointer raw, Size rawsize);
+uint32 rawSample(Pointer raw, Size rawsize);
+bool probeHas(probeSet *p, uint32 n);
+void argFree(FunctionCallInfo fcinfo, int argno, intSet *set);
+intSet *detoastSet(Datum d);
 /*
     ---------------- End of Helper Function Interfaces ----------------
 */
@@ -145,7 +590,7 @@ Datum
 intset_out(PG_FUNCTION_ARGS)
 {
 	// declare everthing on top to make gcc happy
-	intSet *intset = (intSet *) PG_GETARG_POINTER(0);
+	intSet *intset = PG_GETARG_INTSET_P(0);
 	char *result, *temp;
 	uint32_t curr_len, res_len, sofar = 1;
 	uint32 *nums = (uint32 *) VARDATA_ANY(intset);
@@ -207,8 +652,8 @@ Datum
 intset_union(PG_FUNCTION_ARGS)
 {
 	// declare everthing on top to make gcc happy
-	intSet *a = (intSet *) PG_GETARG_POINTER(0);
-	intSet *b = (intSet *) PG_GETARG_POINTER(1);
+	intSet *a = argSet(fcinfo, 0);
+	intSet *b = argSet(fcinfo, 1);
 	intSet *result;
 	TreeNode u_tree = NULL;
 	uint32_t asize = VARSIZE_ANY_EXHDR(a) / 4, bsize = VARSIZE_ANY_EXHDR(b) / 4, u_size = 0;
@@ -247,8 +692,8 @@ Datum
 intset_intersectn(PG_FUNCTION_ARGS)
 {
 	// declare everthing on top to make gcc happy
-	intSet *a = (intSet *) PG_GETARG_POINTER(0);
-	intSet *b = (intSet *) PG_GETARG_POINTER(1);
+	intSet *a = argSet(fcinfo, 0);
+	intSet *b = argSet(fcinfo, 1);
 	intSet *result;
 	TreeNode i_tree = NULL;
 	uint32_t i_size, asize = VARSIZE_ANY_EXHDR(a) / 4, bsize = VARSIZE_ANY_EXHDR(b) / 4;
@@ -291,6 +736,51 @@ intset_intersectn(PG_FUNCTION_ARGS)
 }
 
 
+PG_FUNCTION_INFO_V1(intset_union_all);
+
+Datum
+intset_union_all(PG_FUNCTION_ARGS)
+{
+	/*
+		Given an array of intSets
+		this func returns
+			a pointer to an intset that holds the elements of all of them
+			(NULL if any of them is NULL, like a chain of || would)
+	*/
+	// declare everthing on top to make gcc happy
+	ArrayType *arr = PG_GETARG_ARRAYTYPE_P(0);
+	intSet **sets;
+	int n;
+
+	sets = arrayToSets(arr, &n);
+	if (sets == NULL) PG_RETURN_NULL();
+	PG_RETURN_POINTER(setsUnion(sets, n));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_intersect_all);
+
+Datum
+intset_intersect_all(PG_FUNCTION_ARGS)
+{
+	/*
+		Given an array of intSets
+		this func returns
+			a pointer to an intset that holds the elements they all have
+			(NULL if any of them is NULL, like a chain of && would,
+			or if there are none to intersect)
+	*/
+	// declare everthing on top to make gcc happy
+	ArrayType *arr = PG_GETARG_ARRAYTYPE_P(0);
+	intSet **sets;
+	int n;
+
+	sets = arrayToSets(arr, &n);
+	if (sets == NULL || n == 0) PG_RETURN_NULL();
+	PG_RETURN_POINTER(setsIntersect(sets, n));
+}
+
+
 PG_FUNCTION_INFO_V1(intset_contain_all);
 
 Datum
@@ -304,13 +794,23 @@ intset_contain_all(PG_FUNCTION_ARGS)
 			2) false, otherwise
 	*/
 	// declare everthing on top to make gcc happy
-	intSet *a = (intSet *) PG_GETARG_POINTER(0);
-	intSet *b = (intSet *) PG_GETARG_POINTER(1);
-	uint32 *anums = (uint32 *) VARDATA_ANY(a);
-	uint32 *bnums = (uint32 *) VARDATA_ANY(b);
-	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, bsize = VARSIZE_ANY_EXHDR(b);
+	probeSet *p = probeArg(fcinfo, 0, true);
+	intSet *b = argSet(fcinfo, 1);
+	intSet *a = (p != NULL) ? p->set : PG_GETARG_INTSET_P(0);
+	uint32 *anums, *bnums = (uint32 *) VARDATA_ANY(b);
+	uint32 asize, bsize = VARSIZE_ANY_EXHDR(b) / 4;
 	bool res = true;
 
+	// a constant A with a bitmap is probed for every element of B
+	if (p != NULL && p->bitmap != NULL) {
+		for (uint32 i = 0; i < bsize; i++) {
+			if (!probeHas(p, bnums[i])) PG_RETURN_BOOL(false);
+		}
+		PG_RETURN_BOOL(true);
+	}
+	anums = (uint32 *) VARDATA_ANY(a);
+	asize = VARSIZE_ANY_EXHDR(a) / 4;
+
 	// if the size of A is less than size of B, return false
 	if (asize < bsize) PG_RETURN_BOOL(false);
 
@@ -337,13 +837,23 @@ intset_contain_only(PG_FUNCTION_ARGS)
 			2) false, otherwise
 	*/
 	// declare everthing on top to make gcc happy
-	intSet *a = (intSet *) PG_GETARG_POINTER(0);
-	intSet *b = (intSet *) PG_GETARG_POINTER(1);
-	uint32 *anums = (uint32 *) VARDATA_ANY(a);
-	uint32 *bnums = (uint32 *) VARDATA_ANY(b);
-	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, bsize = VARSIZE_ANY_EXHDR(b) / 4;
+	intSet *a = argSet(fcinfo, 0);
+	probeSet *p = probeArg(fcinfo, 1, true);
+	intSet *b = (p != NULL) ? p->set : PG_GETARG_INTSET_P(1);
+	uint32 *anums = (uint32 *) VARDATA_ANY(a), *bnums;
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, bsize;
 	bool res = true;
 
+	// a constant B with a bitmap is probed for every element of A
+	if (p != NULL && p->bitmap != NULL) {
+		for (uint32 i = 0; i < asize; i++) {
+			if (!probeHas(p, anums[i])) PG_RETURN_BOOL(false);
+		}
+		PG_RETURN_BOOL(true);
+	}
+	bnums = (uint32 *) VARDATA_ANY(b);
+	bsize = VARSIZE_ANY_EXHDR(b) / 4;
+
 	// if the size of A is greater than size of B, return false
 	if (asize > bsize) PG_RETURN_BOOL(false);
 	
@@ -369,15 +879,18 @@ intset_equal(PG_FUNCTION_ARGS)
 			2) false, otherwise
 	*/
 	// declare everthing on top to make gcc happy
-	intSet *a = (intSet *) PG_GETARG_POINTER(0);
-	intSet *b = (intSet *) PG_GETARG_POINTER(1);
+	intSet *a = argSet(fcinfo, 0);
+	intSet *b = argSet(fcinfo, 1);
 	uint32 *anums = (uint32 *) VARDATA_ANY(a);
 	uint32 *bnums = (uint32 *) VARDATA_ANY(b);
 	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, bsize = VARSIZE_ANY_EXHDR(b) / 4;
-
 	// firstly compare the sizes
-	if (asize != bsize) PG_RETURN_BOOL(false);
-	PG_RETURN_BOOL(numsEqual(anums, bnums, asize));
+	bool res = asize == bsize && numsEqual(anums, bnums, asize);
+
+	// btree and hash call this per tuple, so don't leave copies behind
+	argFree(fcinfo, 0, a);
+	argFree(fcinfo, 1, b);
+	PG_RETURN_BOOL(res);
 }
 
 
@@ -393,14 +906,16 @@ intset_not_equal(PG_FUNCTION_ARGS)
 			2) false, otherwise
 	*/
 	// declare everthing on top to make gcc happy
-	intSet *a = (intSet *) PG_GETARG_POINTER(0);
-	intSet *b = (intSet *) PG_GETARG_POINTER(1);
+	intSet *a = argSet(fcinfo, 0);
+	intSet *b = argSet(fcinfo, 1);
 	uint32 *anums = (uint32 *) VARDATA_ANY(a);
 	uint32 *bnums = (uint32 *) VARDATA_ANY(b);
 	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, bsize = VARSIZE_ANY_EXHDR(b) / 4;
+	bool res = asize != bsize || !numsEqual(anums, bnums, asize);
 
-	if (asize != bsize) PG_RETURN_BOOL(true);
-	PG_RETURN_BOOL(!numsEqual(anums, bnums, asize));
+	argFree(fcinfo, 0, a);
+	argFree(fcinfo, 1, b);
+	PG_RETURN_BOOL(res);
 }
 
 
@@ -417,15 +932,178 @@ intset_contains(PG_FUNCTION_ARGS)
 	*/
 	// declare everthing on top to make gcc happy
 	uint32 i = PG_GETARG_UINT32(0);
-	intSet *a = (intSet *) PG_GETARG_POINTER(1);
-	uint32 *anums = (uint32 *) VARDATA_ANY(a);
-	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4;
+	probeSet *p = probeArg(fcinfo, 1, true);
+	intSet *a;
+	uint32 *anums;
+	uint32 asize;
+
+	// a constant A is only probed
+	if (p != NULL) PG_RETURN_BOOL(probeHas(p, i));
+	a = PG_GETARG_INTSET_P(1);
+	anums = (uint32 *) VARDATA_ANY(a);
+	asize = VARSIZE_ANY_EXHDR(a) / 4;
+	if (asize == 0) PG_RETURN_BOOL(false);
+	PG_RETURN_BOOL(binarySearch(anums, 0, asize - 1, i));
+}
+
+
+
+PG_FUNCTION_INFO_V1(intset_has);
+
+Datum
+intset_has(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A & an integer i
+		this func returns
+			1) true, if A contains i
+			2) false, otherwise
+		(this is intset_contains with its arguments the other way around)
+	*/
+	// declare everthing on top to make gcc happy
+	probeSet *p = probeArg(fcinfo, 0, true);
+	uint32 i = PG_GETARG_UINT32(1);
+	intSet *a;
+	uint32 *anums;
+	uint32 asize;
 
+	// a constant A is only probed
+	if (p != NULL) PG_RETURN_BOOL(probeHas(p, i));
+	a = PG_GETARG_INTSET_P(0);
+	anums = (uint32 *) VARDATA_ANY(a);
+	asize = VARSIZE_ANY_EXHDR(a) / 4;
 	if (asize == 0) PG_RETURN_BOOL(false);
 	PG_RETURN_BOOL(binarySearch(anums, 0, asize - 1, i));
 }
 
 
+PG_FUNCTION_INFO_V1(intset_overlaps);
+
+Datum
+intset_overlaps(PG_FUNCTION_ARGS)
+{
+	/*
+		Given 2 intSet A & B
+		this func returns
+			1) true, if A and B have at least one element in common
+			2) false, otherwise
+		unlike A && B, it stops at the first common element
+	*/
+	// declare everthing on top to make gcc happy
+	probeSet *pa = probeArg(fcinfo, 0, true);
+	probeSet *pb = probeArg(fcinfo, 1, true);
+	intSet *a = (pa != NULL) ? pa->set : PG_GETARG_INTSET_P(0);
+	intSet *b = (pb != NULL) ? pb->set : PG_GETARG_INTSET_P(1);
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 *bnums = (uint32 *) VARDATA_ANY(b);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, bsize = VARSIZE_ANY_EXHDR(b) / 4;
+
+	// a constant set with a bitmap is probed for every element of the other
+	if (pb != NULL && pb->bitmap != NULL) {
+		for (uint32 i = 0; i < asize; i++) {
+			if (probeHas(pb, anums[i])) PG_RETURN_BOOL(true);
+		}
+		PG_RETURN_BOOL(false);
+	}
+	if (pa != NULL && pa->bitmap != NULL) {
+		for (uint32 i = 0; i < bsize; i++) {
+			if (probeHas(pa, bnums[i])) PG_RETURN_BOOL(true);
+		}
+		PG_RETURN_BOOL(false);
+	}
+	PG_RETURN_BOOL(numsOverlap(anums, asize, bnums, bsize));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_overlaps_range);
+
+Datum
+intset_overlaps_range(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A & an int4range R
+		this func returns
+			1) true, if A has an element in R
+			2) false, otherwise
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	RangeType *r = PG_GETARG_RANGE_P(1);
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, lo, hi, pos;
+
+	if (!rangeToBounds(r, &lo, &hi)) PG_RETURN_BOOL(false);
+	// the first element from lo on must not be past hi
+	pos = lowerBound(anums, asize, lo);
+	PG_RETURN_BOOL(pos < asize && anums[pos] <= hi);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_within_range);
+
+Datum
+intset_within_range(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A & an int4range R
+		this func returns
+			1) true, if every element of A is in R (so the empty set always is)
+			2) false, otherwise
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	RangeType *r = PG_GETARG_RANGE_P(1);
+	float8 min, max, lo, hi;
+
+	numsSpan((uint32 *) VARDATA_ANY(a), VARSIZE_ANY_EXHDR(a) / 4, &min, &max);
+	PG_RETURN_BOOL(spanQuery(r, INTSET_SPAN_WITHIN_STRATEGY, &lo, &hi) &&
+				   spanConsistent(min, max, lo, hi, INTSET_SPAN_WITHIN_STRATEGY));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_span_overlaps_range);
+
+Datum
+intset_span_overlaps_range(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A & an int4range R
+		this func returns
+			1) true, if the span [min, max] of A overlaps R
+			2) false, otherwise (always for the empty set)
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	RangeType *r = PG_GETARG_RANGE_P(1);
+	float8 min, max, lo, hi;
+
+	numsSpan((uint32 *) VARDATA_ANY(a), VARSIZE_ANY_EXHDR(a) / 4, &min, &max);
+	PG_RETURN_BOOL(spanQuery(r, INTSET_SPAN_OVERLAP_STRATEGY, &lo, &hi) &&
+				   spanConsistent(min, max, lo, hi, INTSET_SPAN_OVERLAP_STRATEGY));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_jaccard_distance);
+
+Datum
+intset_jaccard_distance(PG_FUNCTION_ARGS)
+{
+	/*
+		Given 2 intSet A & B
+		this func returns
+			1 - |A && B| / |A || B|, that is 0 for equal sets and 1 for
+			sets with nothing in common (two empty sets are equal)
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = argSet(fcinfo, 0);
+	intSet *b = argSet(fcinfo, 1);
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 *bnums = (uint32 *) VARDATA_ANY(b);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, bsize = VARSIZE_ANY_EXHDR(b) / 4;
+
+	PG_RETURN_FLOAT8(jaccardDistance(anums, asize, bnums, bsize));
+}
+
 
 PG_FUNCTION_INFO_V1(intset_cardinality);
 
@@ -437,8 +1115,68 @@ intset_cardinality(PG_FUNCTION_ARGS)
 		this func returns
 			the number of elements in A as a 64-bits unsigned int
 	*/
-	intSet *a = (intSet *) PG_GETARG_POINTER(0);
-	PG_RETURN_UINT64(VARSIZE_ANY_EXHDR(a) / 4);
+	// the size is known without detoasting A
+	PG_RETURN_UINT64((toast_raw_datum_size(PG_GETARG_DATUM(0)) - VARHDRSZ) / 4);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_min);
+
+Datum
+intset_min(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A
+		this func returns
+			1) the smallest element of A as an integer, the way ? reads
+			   it (an element over 2147483647 is a negative integer)
+			2) NULL, if A is empty
+	*/
+	// declare everthing on top to make gcc happy
+	uint32 size = (toast_raw_datum_size(PG_GETARG_DATUM(0)) - VARHDRSZ) / 4;
+	uint32 first, last;
+	intSet *a;
+	int32 lo, hi;
+
+	if (size == 0) PG_RETURN_NULL();
+	// only the first and last elements are fetched, unless A has elements
+	// on both sides of PG_INT32_MAX
+	first = sliceElement(PG_GETARG_DATUM(0), 0);
+	last = sliceElement(PG_GETARG_DATUM(0), size - 1);
+	if (first > PG_INT32_MAX || last <= PG_INT32_MAX) PG_RETURN_INT32((int32) first);
+	a = PG_GETARG_INTSET_P(0);
+	numsIntSpan((uint32 *) VARDATA_ANY(a), size, &lo, &hi);
+	PG_RETURN_INT32(lo);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_max);
+
+Datum
+intset_max(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A
+		this func returns
+			1) the largest element of A as an integer, the way ? reads
+			   it (an element over 2147483647 is a negative integer)
+			2) NULL, if A is empty
+	*/
+	// declare everthing on top to make gcc happy
+	uint32 size = (toast_raw_datum_size(PG_GETARG_DATUM(0)) - VARHDRSZ) / 4;
+	uint32 first, last;
+	intSet *a;
+	int32 lo, hi;
+
+	if (size == 0) PG_RETURN_NULL();
+	// only the first and last elements are fetched, unless A has elements
+	// on both sides of PG_INT32_MAX
+	first = sliceElement(PG_GETARG_DATUM(0), 0);
+	last = sliceElement(PG_GETARG_DATUM(0), size - 1);
+	if (first > PG_INT32_MAX || last <= PG_INT32_MAX) PG_RETURN_INT32((int32) last);
+	a = PG_GETARG_INTSET_P(0);
+	numsIntSpan((uint32 *) VARDATA_ANY(a), size, &lo, &hi);
+	PG_RETURN_INT32(hi);
 }
 
 
@@ -454,8 +1192,8 @@ intset_disjunctn(PG_FUNCTION_ARGS)
 			elements in B not in A
 	*/
 	// declare everthing on top to make gcc happy
-	intSet *a = (intSet *) PG_GETARG_POINTER(0);
-	intSet *b = (intSet *) PG_GETARG_POINTER(1);
+	intSet *a = argSet(fcinfo, 0);
+	intSet *b = argSet(fcinfo, 1);
 	uint32 *anums = (uint32 *) VARDATA_ANY(a), *bnums = (uint32 *) VARDATA_ANY(b);
 	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, bsize = VARSIZE_ANY_EXHDR(b) / 4;
 	intSet *result;
@@ -508,8 +1246,8 @@ intset_diff(PG_FUNCTION_ARGS)
 			that is A - (the intersection of A and B)
 	*/
 	// declare everthing on top to make gcc happy
-	intSet *a = (intSet *) PG_GETARG_POINTER(0);
-	intSet *b = (intSet *) PG_GETARG_POINTER(1);
+	intSet *a = argSet(fcinfo, 0);
+	intSet *b = argSet(fcinfo, 1);
 	uint32 *anums = (uint32 *) VARDATA_ANY(a);
 	uint32 *bnums = (uint32 *) VARDATA_ANY(b);
 	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, bsize = VARSIZE_ANY_EXHDR(b) / 4;
@@ -550,135 +1288,4182 @@ intset_diff(PG_FUNCTION_ARGS)
 
 
 
-/*
-    ---------------- Tree operations ----------------
-*/
-// this func create a new tree node
-TreeNode newNode(uint32_t n) {
-    TreeNode res = palloc(sizeof(struct treeNode));
-    res->data = n;
-    res->left = NULL;
-    res->right = NULL;
-    return res;
-}
-
-// computes the height of tree
-uint32_t treeHeight(TreeNode root) {
-	uint32_t left, right;
-	if (root == NULL) return 0;
-	left = treeHeight(root->left);
-	right = treeHeight(root->right);
-	return (left > right ? left : right) + 1;
-}
-
+PG_FUNCTION_INFO_V1(intset_next);
 
-TreeNode left_rotate(TreeNode root) {
-	TreeNode right = root->right;
-	TreeNode right_left = right->left;
-	right->left = root;
-	root->right = right_left;
-	return right;
-}
+Datum
+intset_next(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A, a cursor x and a count n
+		this func returns
+			a pointer to an intset that holds the (at most) n smallest
+			elements of A that are greater than x
+		elements are compared as the integers ? matches them with (see
+		numsIntSpan), so the last element returned is the next cursor
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	int32 x = PG_GETARG_INT32(1);
+	int32 n = PG_GETARG_INT32(2);
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4;
+	uint32 start, count;
 
+	if (n < 0)
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("number of elements must not be negative")));
 
-TreeNode right_rotate(TreeNode root) {
-	TreeNode left = root->left;
-	TreeNode left_right = left->right;
-	left->right = root;
-	root->left = left_right;
-	return left;
+	// only the cursor is searched for, the elements after it are copied as they are
+	start = intUpperBound(anums, asize, x);
+	count = Min(asize - start, (uint32) n);
+	PG_RETURN_POINTER(intSlice(anums, asize, start, start + count));
 }
 
 
-// this func insert a new node into a nums tree
-TreeNode insertNode(uint32_t n, TreeNode root) {
-	int balanced;
-	if (root == NULL) return newNode(n);
+PG_FUNCTION_INFO_V1(intset_prev);
 
-    if (n > root->data) root->right = insertNode(n, root->right);
+Datum
+intset_prev(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A, a cursor x and a count n
+		this func returns
+			a pointer to an intset that holds the (at most) n largest
+			elements of A that are less than x
+		elements are compared as the integers ? matches them with (see
+		numsIntSpan), so the first element returned is the next cursor
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	int32 x = PG_GETARG_INT32(1);
+	int32 n = PG_GETARG_INT32(2);
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4;
+	uint32 end, count;
+
+	if (n < 0)
+		ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			errmsg("number of elements must not be negative")));
+
+	// elements before the cursor are at the positions 0 .. end - 1
+	end = intLowerBound(anums, asize, x);
+	count = Min(end, (uint32) n);
+	PG_RETURN_POINTER(intSlice(anums, asize, end - count, end));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_elements);
+
+Datum
+intset_elements(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A and optionally two bounds lo & hi
+		this func returns
+			the elements of A (that lie in [lo, hi]) one row per call,
+			in ascending order
+		elements are the integers ? matches them with (see numsIntSpan),
+		so the ones over PG_INT32_MAX are negative and come first
+		the set is walked in place, so only the rows actually fetched
+		are ever looked at
+	*/
+	// declare everthing on top to make gcc happy
+	FuncCallContext *funcctx;
+	elementsState *state;
+	uint32 elem;
+
+	if (SRF_IS_FIRSTCALL()) {
+		MemoryContext oldcontext;
+		uint32 *anums, asize;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		state = (elementsState *) palloc(sizeof(elementsState));
+		// if the set has to be detoasted, the copy must live as long as the
+		// multi-call context does (otherwise the passed-in value sticks around)
+		state->set = DatumGetIntSetP(PG_GETARG_DATUM(0));
+		anums = (uint32 *) VARDATA_ANY(state->set);
+		asize = VARSIZE_ANY_EXHDR(state->set) / 4;
+
+		state->wrap = intWrap(anums, asize);
+		state->next = 0;
+		state->end = asize;
+		if (PG_NARGS() == 3) {
+			state->next = intLowerBound(anums, asize, PG_GETARG_INT32(1));
+			state->end = intUpperBound(anums, asize, PG_GETARG_INT32(2));
+			if (state->end < state->next) state->end = state->next;
+		}
+
+		funcctx->user_fctx = state;
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	state = (elementsState *) funcctx->user_fctx;
+
+	if (state->next < state->end) {
+		uint32 size = VARSIZE_ANY_EXHDR(state->set) / 4;
+		// position p of the integer order is nums[(wrap + p) % size]
+		elem = ((uint32 *) VARDATA_ANY(state->set))[(state->wrap + state->next) % size];
+		state->next++;
+		SRF_RETURN_NEXT(funcctx, UInt32GetDatum(elem));
+	}
+	SRF_RETURN_DONE(funcctx);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_add);
+
+Datum
+intset_add(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A & an integer i
+		this func returns
+			a pointer to an intset that holds the elements of A and i
+		i is the element ? matches it with, so a negative i is the
+		element over PG_INT32_MAX with the same bits
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	uint32 i = PG_GETARG_UINT32(1);
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, pos;
+	intSet *result;
+	uint32 *res_nums;
+
+	// if i is already in A, A is the answer
+	pos = lowerBound(anums, asize, i);
+	if (pos < asize && anums[pos] == i) PG_RETURN_POINTER(a);
+
+	// copy the elements before and after i around it
+	result = (intSet *) palloc(VARHDRSZ + (asize + 1) * 4);
+	SET_VARSIZE(result, VARHDRSZ + (asize + 1) * 4);
+	res_nums = (uint32 *) VARDATA_ANY(result);
+	memcpy(res_nums, anums, pos * 4);
+	res_nums[pos] = i;
+	memcpy(res_nums + pos + 1, anums + pos, (asize - pos) * 4);
+	PG_RETURN_POINTER(result);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_remove);
+
+Datum
+intset_remove(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A & an integer i
+		this func returns
+			a pointer to an intset that holds the elements of A except i
+		i is the element ? matches it with, as in intset_add
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	uint32 i = PG_GETARG_UINT32(1);
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, pos;
+	intSet *result;
+	uint32 *res_nums;
+
+	// if i is not in A, A is the answer
+	pos = lowerBound(anums, asize, i);
+	if (pos == asize || anums[pos] != i) PG_RETURN_POINTER(a);
+
+	// copy the elements before and after i next to each other
+	result = (intSet *) palloc(VARHDRSZ + (asize - 1) * 4);
+	SET_VARSIZE(result, VARHDRSZ + (asize - 1) * 4);
+	res_nums = (uint32 *) VARDATA_ANY(result);
+	memcpy(res_nums, anums, pos * 4);
+	memcpy(res_nums + pos, anums + pos + 1, (asize - pos - 1) * 4);
+	PG_RETURN_POINTER(result);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_add_all);
+
+Datum
+intset_add_all(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A & an integer array B
+		this func returns
+			a pointer to an intset that holds the elements of A and B
+		the integers of B are read as in intset_add
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	ArrayType *arr = PG_GETARG_ARRAYTYPE_P(1);
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, bsize;
+	uint32 *bnums;
+	intSet *result;
+
+	// sort B once and merge it into A in a single pass
+	bnums = arrayToNums(arr, &bsize);
+	if (bsize == 0) {
+		pfree(bnums);
+		PG_RETURN_POINTER(a);
+	}
+
+	// count the common elements first, so the result is allocated exactly
+	result = allocIntSet((uint64) asize + bsize - numsIntersectSize(anums, asize, bnums, bsize));
+	mergeUnion(anums, asize, bnums, bsize, (uint32 *) VARDATA_ANY(result));
+
+	pfree(bnums);
+	PG_RETURN_POINTER(result);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_remove_all);
+
+Datum
+intset_remove_all(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A & an integer array B
+		this func returns
+			a pointer to an intset that holds the elements of A not in B
+		the integers of B are read as in intset_add
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	ArrayType *arr = PG_GETARG_ARRAYTYPE_P(1);
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, bsize;
+	uint32 *bnums;
+	intSet *result;
+
+	bnums = arrayToNums(arr, &bsize);
+	if (bsize == 0 || asize == 0) {
+		pfree(bnums);
+		PG_RETURN_POINTER(a);
+	}
+
+	// the same for the difference
+	result = allocIntSet(asize - numsIntersectSize(anums, asize, bnums, bsize));
+	mergeDiff(anums, asize, bnums, bsize, (uint32 *) VARDATA_ANY(result));
+
+	pfree(bnums);
+	PG_RETURN_POINTER(result);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_add_range);
+
+Datum
+intset_add_range(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A & two integers lo, hi
+		this func returns
+			a pointer to an intset that holds the elements of A and
+			every integer in [lo, hi]
+		the integers are the elements ? matches them with, so a range
+		across 0 is two runs of elements: from (uint32) lo up to
+		PG_UINT32_MAX and from 0 up to hi
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	int32 lo = PG_GETARG_INT32(1), hi = PG_GETARG_INT32(2);
+	intSet *part, *result;
+
+	// an empty range doesn't change anything
+	if (lo > hi) PG_RETURN_POINTER(a);
+	if (lo >= 0 || hi < 0) PG_RETURN_POINTER(setAddRange(a, (uint32) lo, (uint32) hi));
+
+	part = setAddRange(a, (uint32) lo, PG_UINT32_MAX);
+	result = setAddRange(part, 0, (uint32) hi);
+	if (part != a && part != result) pfree(part);
+	PG_RETURN_POINTER(result);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_remove_range);
+
+Datum
+intset_remove_range(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A & two integers lo, hi
+		this func returns
+			a pointer to an intset that holds the elements of A
+			that are not in [lo, hi]
+		the range is read as in intset_add_range
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	int32 lo = PG_GETARG_INT32(1), hi = PG_GETARG_INT32(2);
+	intSet *part, *result;
+
+	// an empty range doesn't change anything
+	if (lo > hi) PG_RETURN_POINTER(a);
+	if (lo >= 0 || hi < 0) PG_RETURN_POINTER(setRemoveRange(a, (uint32) lo, (uint32) hi));
+
+	part = setRemoveRange(a, (uint32) lo, PG_UINT32_MAX);
+	result = setRemoveRange(part, 0, (uint32) hi);
+	if (part != a && part != result) pfree(part);
+	PG_RETURN_POINTER(result);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_flip_range);
+
+Datum
+intset_flip_range(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A & two integers lo, hi
+		this func returns
+			a pointer to an intset that holds the elements of A outside
+			[lo, hi] and the integers in [lo, hi] that are not in A
+		the range is read as in intset_add_range
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	int32 lo = PG_GETARG_INT32(1), hi = PG_GETARG_INT32(2);
+	intSet *part, *result;
+
+	// an empty range doesn't change anything
+	if (lo > hi) PG_RETURN_POINTER(a);
+	if (lo >= 0 || hi < 0) PG_RETURN_POINTER(setFlipRange(a, (uint32) lo, (uint32) hi));
+
+	part = setFlipRange(a, (uint32) lo, PG_UINT32_MAX);
+	result = setFlipRange(part, 0, (uint32) hi);
+	if (part != a && part != result) pfree(part);
+	PG_RETURN_POINTER(result);
+}
+
+
+/*****************************************************************************
+ * Ordering and sort support
+ *
+ * Sets are ordered lexicographically by their sorted elements, and a set
+ * that is a prefix of another one comes first ({} < {1} < {1,2} < {2}).
+ *****************************************************************************/
+
+static int intset_fastcmp(Datum x, Datum y, SortSupport ssup);
+static int intset_cmp_abbrev(Datum x, Datum y, SortSupport ssup);
+static Datum intset_abbrev_convert(Datum original, SortSupport ssup);
+static bool intset_abbrev_abort(int memtupcount, SortSupport ssup);
+
+PG_FUNCTION_INFO_V1(intset_cmp);
+
+Datum
+intset_cmp(PG_FUNCTION_ARGS)
+{
+	/*
+		Given 2 intSet A & B
+		this func returns
+			a negative number, 0 or a positive number if A is less than,
+			equal to or greater than B
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = argSet(fcinfo, 0);
+	intSet *b = argSet(fcinfo, 1);
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 *bnums = (uint32 *) VARDATA_ANY(b);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, bsize = VARSIZE_ANY_EXHDR(b) / 4;
+	int32 res = numsCompare(anums, asize, bnums, bsize);
+
+	// btree calls this per tuple, so don't leave copies behind
+	argFree(fcinfo, 0, a);
+	argFree(fcinfo, 1, b);
+	PG_RETURN_INT32(res);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_lt);
+
+Datum
+intset_lt(PG_FUNCTION_ARGS)
+{
+	int32 res = DatumGetInt32(intset_cmp(fcinfo));
+	PG_RETURN_BOOL(res < 0);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_le);
+
+Datum
+intset_le(PG_FUNCTION_ARGS)
+{
+	int32 res = DatumGetInt32(intset_cmp(fcinfo));
+	PG_RETURN_BOOL(res <= 0);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gt);
+
+Datum
+intset_gt(PG_FUNCTION_ARGS)
+{
+	int32 res = DatumGetInt32(intset_cmp(fcinfo));
+	PG_RETURN_BOOL(res > 0);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_ge);
+
+Datum
+intset_ge(PG_FUNCTION_ARGS)
+{
+	int32 res = DatumGetInt32(intset_cmp(fcinfo));
+	PG_RETURN_BOOL(res >= 0);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_sortsupport);
+
+Datum
+intset_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+	abbrevState *state;
+	MemoryContext oldcontext;
+
+	ssup->comparator = intset_fastcmp;
+	ssup->ssup_extra = NULL;
+
+	if (ssup->abbreviate) {
+		oldcontext = MemoryContextSwitchTo(ssup->ssup_cxt);
+		state = (abbrevState *) palloc(sizeof(abbrevState));
+		state->input_count = 0;
+		state->estimating = true;
+		initHyperLogLog(&state->abbr_card, 10);
+
+		ssup->ssup_extra = state;
+		ssup->comparator = intset_cmp_abbrev;
+		ssup->abbrev_converter = intset_abbrev_convert;
+		ssup->abbrev_abort = intset_abbrev_abort;
+		ssup->abbrev_full_comparator = intset_fastcmp;
+		MemoryContextSwitchTo(oldcontext);
+	}
+	PG_RETURN_VOID();
+}
+
+// compares 2 (possibly toasted) sets for the sort
+static int intset_fastcmp(Datum x, Datum y, SortSupport ssup) {
+	intSet *a = DatumGetIntSetP(x);
+	intSet *b = DatumGetIntSetP(y);
+	int res;
+
+	res = numsCompare((uint32 *) VARDATA_ANY(a), VARSIZE_ANY_EXHDR(a) / 4,
+					  (uint32 *) VARDATA_ANY(b), VARSIZE_ANY_EXHDR(b) / 4);
+
+	// free the detoasted copies, the sort calls this a lot
+	if ((Pointer) a != DatumGetPointer(x)) pfree(a);
+	if ((Pointer) b != DatumGetPointer(y)) pfree(b);
+	return res;
+}
+
+// abbreviated keys compare as unsigned integers
+static int intset_cmp_abbrev(Datum x, Datum y, SortSupport ssup) {
+	if (x > y) return 1;
+	else if (x == y) return 0;
+	else return -1;
+}
+
+// builds the abbreviated key of a set from its first elements only
+/*
+    with 64-bit datums the key is (from the highest bit down)
+        1 bit  : the set is not empty
+        32 bits: the first element
+        1 bit  : the set has a second element
+        30 bits: the top 30 bits of the second element
+    so an empty set gets 0 and {x} sorts before every {x, ...}.
+    with 32-bit datums only the top 31 bits of the first element fit.
+    only the first 8 bytes of the elements are fetched, so a toasted
+    set is never detoasted as a whole here.
+*/
+static Datum intset_abbrev_convert(Datum original, SortSupport ssup) {
+	abbrevState *state = (abbrevState *) ssup->ssup_extra;
+	intSet *a = (intSet *) PG_DETOAST_DATUM_SLICE(original, 0, 8);
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4;
+	Datum res = 0;
+	uint32 hash;
+
+#if SIZEOF_DATUM == 8
+	if (asize > 0) {
+		res = ((Datum) 1 << 63) | ((Datum) anums[0] << 31);
+		if (asize > 1) res |= ((Datum) 1 << 30) | (anums[1] >> 2);
+	}
+	hash = (uint32) (res ^ (res >> 32));
+#else
+	if (asize > 0) res = ((Datum) 1 << 31) | (anums[0] >> 1);
+	hash = (uint32) res;
+#endif
+
+	state->input_count++;
+	if (state->estimating) addHyperLogLog(&state->abbr_card, DatumGetUInt32(hash_uint32(hash)));
+
+	pfree(a);
+	return res;
+}
+
+// gives up on abbreviation if the keys turn out to be mostly the same
+// (this is the same heuristic as the one used by uuid)
+static bool intset_abbrev_abort(int memtupcount, SortSupport ssup) {
+	abbrevState *state = (abbrevState *) ssup->ssup_extra;
+	double abbr_card;
+
+	if (memtupcount < 10000 || state->input_count < 10000 || !state->estimating) return false;
+
+	abbr_card = estimateHyperLogLog(&state->abbr_card);
+
+	// the keys are distinct enough, stop estimating and keep abbreviating
+	if (abbr_card > 100000.0) {
+		state->estimating = false;
+		return false;
+	}
+
+	// abort if fewer than 1 in 2000 of the keys are distinct
+	if (abbr_card < state->input_count / 2000.0 + 0.5) return true;
+	return false;
+}
+
+
+/*****************************************************************************
+ * Hashing
+ *
+ * The elements are kept sorted and distinct, so equal sets always have the
+ * same bytes and can simply be hashed as a block.
+ *****************************************************************************/
+
+PG_FUNCTION_INFO_V1(intset_hash);
+
+Datum
+intset_hash(PG_FUNCTION_ARGS)
+{
+	// the bytes are hashed where they are, aligned or not
+	struct varlena *a = PG_DETOAST_DATUM_PACKED(PG_GETARG_DATUM(0));
+	Datum res = hash_any((unsigned char *) VARDATA_ANY(a), VARSIZE_ANY_EXHDR(a));
+
+	PG_FREE_IF_COPY(a, 0);
+	return res;
+}
+
+
+PG_FUNCTION_INFO_V1(intset_hash_extended);
+
+Datum
+intset_hash_extended(PG_FUNCTION_ARGS)
+{
+	struct varlena *a = PG_DETOAST_DATUM_PACKED(PG_GETARG_DATUM(0));
+	uint64 seed = PG_GETARG_INT64(1);
+	Datum res = hash_any_extended((unsigned char *) VARDATA_ANY(a), VARSIZE_ANY_EXHDR(a), seed);
+
+	PG_FREE_IF_COPY(a, 0);
+	return res;
+}
+
+
+/*****************************************************************************
+ * GIN support
+ *
+ * Every element of a set is a key of the index. The keys are stored as
+ * integers but compared as unsigned ones, in the same order as nums[].
+ *****************************************************************************/
+
+PG_FUNCTION_INFO_V1(intset_gin_compare);
+
+Datum
+intset_gin_compare(PG_FUNCTION_ARGS)
+{
+	uint32 a = PG_GETARG_UINT32(0);
+	uint32 b = PG_GETARG_UINT32(1);
+
+	if (a == b) PG_RETURN_INT32(0);
+	PG_RETURN_INT32((a < b) ? -1 : 1);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gin_extract_value);
+
+Datum
+intset_gin_extract_value(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A
+		this func returns
+			the elements of A as the index keys of A
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	int32 *nentries = (int32 *) PG_GETARG_POINTER(1);
+
+	PG_RETURN_POINTER(ginNumsKeys((uint32 *) VARDATA_ANY(a), VARSIZE_ANY_EXHDR(a) / 4,
+								  0, nentries));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gin_extract_query);
+
+Datum
+intset_gin_extract_query(PG_FUNCTION_ARGS)
+{
+	/*
+		Given the right-hand side of an indexable operator
+		this func returns
+			the keys that have to be looked up in the index
+		the query is an integer for ?, an int4range for &&> and an intset for the
+		other operators
+	*/
+	PG_RETURN_POINTER(ginQueryKeys(fcinfo, 0));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gin_compare_partial);
+
+Datum
+intset_gin_compare_partial(PG_FUNCTION_ARGS)
+{
+	/*
+		the keys come in ascending order from the lower end of the range,
+		so a key is a match until one passes the upper end
+	*/
+	uint32 key = PG_GETARG_UINT32(1);
+	Pointer extra_data = (Pointer) PG_GETARG_POINTER(3);
+	uint32 hi = *((uint32 *) extra_data);
+
+	PG_RETURN_INT32((key > hi) ? 1 : 0);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gin_consistent);
+
+Datum
+intset_gin_consistent(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	bool *check = (bool *) PG_GETARG_POINTER(0);
+	StrategyNumber strategy = PG_GETARG_UINT16(1);
+	int32 nkeys = PG_GETARG_INT32(3);
+	bool *recheck = (bool *) PG_GETARG_POINTER(5);
+
+	PG_RETURN_BOOL(ginConsistent(check, strategy, nkeys, recheck));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gin_triconsistent);
+
+Datum
+intset_gin_triconsistent(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	GinTernaryValue *check = (GinTernaryValue *) PG_GETARG_POINTER(0);
+	StrategyNumber strategy = PG_GETARG_UINT16(1);
+	int32 nkeys = PG_GETARG_INT32(3);
+
+	PG_RETURN_GIN_TERNARY_VALUE(ginTriConsistent(check, strategy, nkeys));
+}
+
+
+/*****************************************************************************
+ * Bucketed GIN support
+ *
+ * For sets with millions of elements, an element per key makes a huge index
+ * that is slow to write. intset_gin_bucket_ops indexes the buckets
+ * (element >> bucket_bits) of a set instead, so a key stands for up to
+ * 2^bucket_bits elements. The index is much smaller but can only tell that a
+ * set may match, so every row it returns is rechecked.
+ *****************************************************************************/
+
+PG_FUNCTION_INFO_V1(intset_gin_bucket_extract_value);
+
+Datum
+intset_gin_bucket_extract_value(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A
+		this func returns
+			the buckets of the elements of A as the index keys of A
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = PG_GETARG_INTSET_P(0);
+	int32 *nentries = (int32 *) PG_GETARG_POINTER(1);
+
+	PG_RETURN_POINTER(ginNumsKeys((uint32 *) VARDATA_ANY(a), VARSIZE_ANY_EXHDR(a) / 4,
+								  GET_BUCKET_BITS(), nentries));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gin_bucket_extract_query);
+
+Datum
+intset_gin_bucket_extract_query(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_POINTER(ginQueryKeys(fcinfo, GET_BUCKET_BITS()));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gin_bucket_consistent);
+
+Datum
+intset_gin_bucket_consistent(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	bool *check = (bool *) PG_GETARG_POINTER(0);
+	StrategyNumber strategy = PG_GETARG_UINT16(1);
+	int32 nkeys = PG_GETARG_INT32(3);
+	bool *recheck = (bool *) PG_GETARG_POINTER(5);
+	bool res;
+
+	res = ginConsistent(check, strategy, nkeys, recheck);
+	// having the bucket of an element doesn't mean having the element
+	*recheck = true;
+	PG_RETURN_BOOL(res);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gin_bucket_triconsistent);
+
+Datum
+intset_gin_bucket_triconsistent(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	GinTernaryValue *check = (GinTernaryValue *) PG_GETARG_POINTER(0);
+	StrategyNumber strategy = PG_GETARG_UINT16(1);
+	int32 nkeys = PG_GETARG_INT32(3);
+	GinTernaryValue res;
+
+	res = ginTriConsistent(check, strategy, nkeys);
+	// a match always needs a recheck
+	if (res == GIN_TRUE) res = GIN_MAYBE;
+	PG_RETURN_GIN_TERNARY_VALUE(res);
+}
+
+
+#if PG_VERSION_NUM >= 130000
+PG_FUNCTION_INFO_V1(intset_gin_bucket_options);
+
+Datum
+intset_gin_bucket_options(PG_FUNCTION_ARGS)
+{
+	local_relopts *relopts = (local_relopts *) PG_GETARG_POINTER(0);
+
+	init_local_reloptions(relopts, sizeof(intSetGinOptions));
+	add_local_int_reloption(relopts, "bucket_bits", "number of low bits dropped from an element to get its bucket",
+							BUCKET_BITS_DEFAULT, 0, BUCKET_BITS_MAX,
+							offsetof(intSetGinOptions, bucket_bits));
+	PG_RETURN_VOID();
+}
+#endif
+
+
+/*****************************************************************************
+ * GiST support
+ *
+ * Inner keys are signatures: bitmaps of siglen bytes with the bit
+ * (element % (siglen * 8)) set for every element of every set below them.
+ * A leaf keeps its set as it is if it has at most GIST_EXACT_MAX elements,
+ * so it is checked exactly, and a signature (that needs a recheck) otherwise.
+ *****************************************************************************/
+
+bool gistExactConsistent(uint32 *knums, uint32 ksize, uint32 *qnums, uint32 qsize,
+						 StrategyNumber strategy);
+bool gistSignConsistent(intSetGistKey *key, uint32 *qnums, uint32 qsize,
+						StrategyNumber strategy, bool leaf, int siglen);
+
+PG_FUNCTION_INFO_V1(intset_gist_consistent);
+
+Datum
+intset_gist_consistent(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+	StrategyNumber strategy = (StrategyNumber) PG_GETARG_UINT16(2);
+	bool *recheck = (bool *) PG_GETARG_POINTER(4);
+	intSetGistKey *key = (intSetGistKey *) DatumGetPointer(entry->key);
+	int siglen = GET_SIGLEN();
+	uint32 single, *qnums, qsize;
+	intSet *q;
+
+	if (strategy == INTSET_HAS_STRATEGY) {
+		// the query of ? is one integer, look for it as a set of one
+		// (read as unsigned, the way the operator reads it)
+		*recheck = false;
+		single = PG_GETARG_UINT32(1);
+		qnums = &single;
+		qsize = 1;
+		strategy = INTSET_CONTAINS_STRATEGY;
+	} else {
+		q = PG_GETARG_INTSET_P(1);
+		qnums = (uint32 *) VARDATA_ANY(q);
+		qsize = VARSIZE_ANY_EXHDR(q) / 4;
+	}
+
+	if (key->flag & GKEY_EXACT) {
+		*recheck = false;
+		PG_RETURN_BOOL(gistExactConsistent((uint32 *) key->data, (VARSIZE(key) - GKEY_HDRSZ) / 4,
+										   qnums, qsize, strategy));
+	}
+	// a signature can only rule rows out
+	*recheck = true;
+	PG_RETURN_BOOL(gistSignConsistent(key, qnums, qsize, strategy, GIST_LEAF(entry), siglen));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gist_distance);
+
+Datum
+intset_gist_distance(PG_FUNCTION_ARGS)
+{
+	/*
+		exact leaves get their exact Jaccard distance to the query
+		for a signature, at most m of the query elements (those whose bits
+		are set) can be in a set under it, so a set of c elements shares
+		at most min(m, c) with the query. the best distance any set can
+		then have is reached at c = m (or the closest c in the range of
+		set sizes under the key), which gives a lower bound
+	*/
+	// declare everthing on top to make gcc happy
+	GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+	intSet *q = PG_GETARG_INTSET_P(1);
+	bool *recheck = (bool *) PG_GETARG_POINTER(4);
+	intSetGistKey *key = (intSetGistKey *) DatumGetPointer(entry->key);
+	int siglen = GET_SIGLEN();
+	uint32 *qnums = (uint32 *) VARDATA_ANY(q);
+	uint32 qsize = VARSIZE_ANY_EXHDR(q) / 4;
+	uint32 m = 0, c, common;
+	char *ksign;
+
+	if (key->flag & GKEY_EXACT) {
+		*recheck = false;
+		PG_RETURN_FLOAT8(jaccardDistance((uint32 *) key->data, key->mincard, qnums, qsize));
+	}
+
+	// a leaf signature only gives a bound on the distance of its set
+	*recheck = GIST_LEAF(entry);
+	ksign = keySign(key, siglen);
+	for (uint32 i = 0; i < qsize; i++) {
+		uint32 h = qnums[i] % (siglen * 8);
+		if (ksign == NULL || (ksign[h / 8] & (1 << (h % 8)))) m++;
+	}
+
+	c = Max(key->mincard, Min(m, key->maxcard));
+	common = Min(m, c);
+	// only two empty sets have nothing in their union
+	if (c + qsize - common == 0) PG_RETURN_FLOAT8(0.0);
+	PG_RETURN_FLOAT8(1.0 - (double) common / (double) (c + qsize - common));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gist_union);
+
+Datum
+intset_gist_union(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	GistEntryVector *entryvec = (GistEntryVector *) PG_GETARG_POINTER(0);
+	int *size = (int *) PG_GETARG_POINTER(1);
+	int siglen = GET_SIGLEN();
+	char *sign = (char *) palloc0(siglen);
+	intSetGistKey *key, *result;
+	uint32 mincard = PG_UINT32_MAX, maxcard = 0;
+
+	// OR the signatures of all the entries together
+	for (int32 i = 0; i < entryvec->n; i++) {
+		char *ksign;
+		key = (intSetGistKey *) DatumGetPointer(entryvec->vector[i].key);
+		ksign = keySign(key, siglen);
+		signUnion(sign, ksign, siglen);
+		if (key->flag & GKEY_EXACT) pfree(ksign);
+		mincard = Min(mincard, key->mincard);
+		maxcard = Max(maxcard, key->maxcard);
+	}
+	result = makeSignKey(sign, siglen, mincard, maxcard);
+	pfree(sign);
+
+	*size = VARSIZE(result);
+	PG_RETURN_POINTER(result);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gist_compress);
+
+Datum
+intset_gist_compress(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+	int siglen = GET_SIGLEN();
+	GISTENTRY *retval;
+	intSet *a;
+	uint32 *anums, asize;
+	intSetGistKey *key;
+	char *sign;
+
+	// inner keys come out of union as signatures already
+	if (!entry->leafkey) PG_RETURN_POINTER(entry);
+
+	a = DatumGetIntSetP(entry->key);
+	anums = (uint32 *) VARDATA_ANY(a);
+	asize = VARSIZE_ANY_EXHDR(a) / 4;
+	if (asize <= GIST_EXACT_MAX) {
+		key = makeExactKey(anums, asize);
+	} else {
+		sign = (char *) palloc0(siglen);
+		signAddNums(sign, siglen, anums, asize);
+		key = makeSignKey(sign, siglen, asize, asize);
+		pfree(sign);
+	}
+	if ((Pointer) a != DatumGetPointer(entry->key)) pfree(a);
+
+	retval = (GISTENTRY *) palloc(sizeof(GISTENTRY));
+	gistentryinit(*retval, PointerGetDatum(key), entry->rel, entry->page, entry->offset, false);
+	PG_RETURN_POINTER(retval);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gist_decompress);
+
+Datum
+intset_gist_decompress(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+	intSetGistKey *key = (intSetGistKey *) PG_DETOAST_DATUM(entry->key);
+	GISTENTRY *retval;
+
+	if ((Pointer) key == DatumGetPointer(entry->key)) PG_RETURN_POINTER(entry);
+
+	retval = (GISTENTRY *) palloc(sizeof(GISTENTRY));
+	gistentryinit(*retval, PointerGetDatum(key), entry->rel, entry->page, entry->offset, entry->leafkey);
+	PG_RETURN_POINTER(retval);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gist_penalty);
+
+Datum
+intset_gist_penalty(PG_FUNCTION_ARGS)
+{
+	/*
+		the penalty of putting a new entry under a key is the number of
+		bits that differ between their signatures
+	*/
+	// declare everthing on top to make gcc happy
+	GISTENTRY *origentry = (GISTENTRY *) PG_GETARG_POINTER(0);
+	GISTENTRY *newentry = (GISTENTRY *) PG_GETARG_POINTER(1);
+	float *penalty = (float *) PG_GETARG_POINTER(2);
+	intSetGistKey *orig = (intSetGistKey *) DatumGetPointer(origentry->key);
+	intSetGistKey *new = (intSetGistKey *) DatumGetPointer(newentry->key);
+	int siglen = GET_SIGLEN();
+	char *osign = keySign(orig, siglen), *nsign = keySign(new, siglen);
+
+	*penalty = (float) hemdistSign(osign, nsign, siglen);
+
+	// signatures of exact keys are made up on the fly
+	if (orig->flag & GKEY_EXACT) pfree(osign);
+	if (new->flag & GKEY_EXACT) pfree(nsign);
+	PG_RETURN_POINTER(penalty);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gist_picksplit);
+
+Datum
+intset_gist_picksplit(PG_FUNCTION_ARGS)
+{
+	/*
+		the two entries whose signatures are furthest apart start the two
+		sides, then every other entry goes to the side whose signature is
+		closer to its own
+	*/
+	// declare everthing on top to make gcc happy
+	GistEntryVector *entryvec = (GistEntryVector *) PG_GETARG_POINTER(0);
+	GIST_SPLITVEC *v = (GIST_SPLITVEC *) PG_GETARG_POINTER(1);
+	int siglen = GET_SIGLEN();
+	OffsetNumber maxoff = entryvec->n - 1, seed_1 = FirstOffsetNumber, seed_2 = FirstOffsetNumber + 1;
+	char **signs, *unionL, *unionR;
+	int waste = -1, dl, dr;
+	intSetGistKey *key;
+	uint32 minL = PG_UINT32_MAX, maxL = 0, minR = PG_UINT32_MAX, maxR = 0;
+
+	v->spl_left = (OffsetNumber *) palloc((maxoff + 1) * sizeof(OffsetNumber));
+	v->spl_right = (OffsetNumber *) palloc((maxoff + 1) * sizeof(OffsetNumber));
+	v->spl_nleft = 0;
+	v->spl_nright = 0;
+
+	// work out the signature of every entry once
+	signs = (char **) palloc((maxoff + 1) * sizeof(char *));
+	for (OffsetNumber i = FirstOffsetNumber; i <= maxoff; i = OffsetNumberNext(i)) {
+		key = (intSetGistKey *) DatumGetPointer(entryvec->vector[i].key);
+		signs[i] = keySign(key, siglen);
+	}
+
+	for (OffsetNumber i = FirstOffsetNumber; i < maxoff; i = OffsetNumberNext(i)) {
+		for (OffsetNumber j = OffsetNumberNext(i); j <= maxoff; j = OffsetNumberNext(j)) {
+			int d = hemdistSign(signs[i], signs[j], siglen);
+			if (d > waste) {
+				waste = d;
+				seed_1 = i;
+				seed_2 = j;
+			}
+		}
+	}
+
+	unionL = (char *) palloc0(siglen);
+	unionR = (char *) palloc0(siglen);
+	signUnion(unionL, signs[seed_1], siglen);
+	signUnion(unionR, signs[seed_2], siglen);
+
+	for (OffsetNumber i = FirstOffsetNumber; i <= maxoff; i = OffsetNumberNext(i)) {
+		key = (intSetGistKey *) DatumGetPointer(entryvec->vector[i].key);
+		if (i == seed_1) {
+			dl = 0;
+			dr = 1;
+		} else if (i == seed_2) {
+			dl = 1;
+			dr = 0;
+		} else {
+			dl = hemdistSign(unionL, signs[i], siglen);
+			dr = hemdistSign(unionR, signs[i], siglen);
+		}
+		// on a tie the smaller side gets it
+		if (dl < dr || (dl == dr && v->spl_nleft < v->spl_nright)) {
+			signUnion(unionL, signs[i], siglen);
+			minL = Min(minL, key->mincard);
+			maxL = Max(maxL, key->maxcard);
+			v->spl_left[v->spl_nleft++] = i;
+		} else {
+			signUnion(unionR, signs[i], siglen);
+			minR = Min(minR, key->mincard);
+			maxR = Max(maxR, key->maxcard);
+			v->spl_right[v->spl_nright++] = i;
+		}
+	}
+
+	v->spl_ldatum = PointerGetDatum(makeSignKey(unionL, siglen, minL, maxL));
+	v->spl_rdatum = PointerGetDatum(makeSignKey(unionR, siglen, minR, maxR));
+	PG_RETURN_POINTER(v);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gist_same);
+
+Datum
+intset_gist_same(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	intSetGistKey *a = (intSetGistKey *) PG_GETARG_POINTER(0);
+	intSetGistKey *b = (intSetGistKey *) PG_GETARG_POINTER(1);
+	bool *result = (bool *) PG_GETARG_POINTER(2);
+
+	*result = VARSIZE(a) == VARSIZE(b) && a->flag == b->flag &&
+			  a->mincard == b->mincard && a->maxcard == b->maxcard &&
+			  memcmp(a->data, b->data, VARSIZE(a) - GKEY_HDRSZ) == 0;
+	PG_RETURN_POINTER(result);
+}
+
+
+#if PG_VERSION_NUM >= 130000
+PG_FUNCTION_INFO_V1(intset_gist_options);
+
+Datum
+intset_gist_options(PG_FUNCTION_ARGS)
+{
+	local_relopts *relopts = (local_relopts *) PG_GETARG_POINTER(0);
+
+	init_local_reloptions(relopts, sizeof(intSetGistOptions));
+	add_local_int_reloption(relopts, "siglen", "signature length in bytes",
+							SIGLEN_DEFAULT, 1, SIGLEN_MAX,
+							offsetof(intSetGistOptions, siglen));
+	PG_RETURN_VOID();
+}
+#endif
+
+
+PG_FUNCTION_INFO_V1(intset_gkey_in);
+
+Datum
+intset_gkey_in(PG_FUNCTION_ARGS)
+{
+	ereport(ERROR,
+		(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+		errmsg("cannot accept a value of type %s", "intset_gkey")));
+	PG_RETURN_VOID();
+}
+
+
+PG_FUNCTION_INFO_V1(intset_gkey_out);
+
+Datum
+intset_gkey_out(PG_FUNCTION_ARGS)
+{
+	ereport(ERROR,
+		(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+		errmsg("cannot display a value of type %s", "intset_gkey")));
+	PG_RETURN_VOID();
+}
+
+// checks a leaf set against the query exactly
+bool gistExactConsistent(uint32 *knums, uint32 ksize, uint32 *qnums, uint32 qsize,
+						 StrategyNumber strategy) {
+	switch (strategy) {
+		case INTSET_OVERLAP_STRATEGY:
+			return numsOverlap(knums, ksize, qnums, qsize);
+		case INTSET_EQUAL_STRATEGY:
+			return ksize == qsize && numsEqual(knums, qnums, ksize);
+		case INTSET_CONTAINS_STRATEGY:
+			return numsContain(knums, ksize, qnums, qsize);
+		case INTSET_CONTAINED_STRATEGY:
+			return numsContain(qnums, qsize, knums, ksize);
+		default:
+			elog(ERROR, "unrecognized strategy number: %d", strategy);
+	}
+	return false;
+}
+
+// checks whether any set under a signature could match the query
+bool gistSignConsistent(intSetGistKey *key, uint32 *qnums, uint32 qsize,
+						StrategyNumber strategy, bool leaf, int siglen) {
+	char *ksign = keySign(key, siglen), *qsign;
+	bool res = true;
+
+	switch (strategy) {
+		case INTSET_OVERLAP_STRATEGY:
+			// one of the query elements must have its bit set
+			res = false;
+			for (uint32 i = 0; i < qsize && !res; i++) {
+				uint32 h = qnums[i] % (siglen * 8);
+				res = (ksign == NULL) || (ksign[h / 8] & (1 << (h % 8)));
+			}
+			break;
+		case INTSET_EQUAL_STRATEGY:
+		case INTSET_CONTAINS_STRATEGY:
+			// all of the query elements must have their bits set
+			for (uint32 i = 0; i < qsize && res && ksign != NULL; i++) {
+				uint32 h = qnums[i] % (siglen * 8);
+				res = (ksign[h / 8] & (1 << (h % 8))) != 0;
+			}
+			// a leaf that equals the query has exactly the query's signature
+			if (res && leaf && strategy == INTSET_EQUAL_STRATEGY) {
+				qsign = (char *) palloc0(siglen);
+				signAddNums(qsign, siglen, qnums, qsize);
+				res = hemdistSign(ksign, qsign, siglen) == 0;
+				pfree(qsign);
+			}
+			break;
+		case INTSET_CONTAINED_STRATEGY:
+			// an inner key may hold smaller sets, but a leaf can't have bits
+			// that the query doesn't have
+			if (leaf) {
+				qsign = (char *) palloc0(siglen);
+				signAddNums(qsign, siglen, qnums, qsize);
+				if (ksign == NULL) {
+					res = hemdistSign(NULL, qsign, siglen) == 0;
+				} else {
+					for (int i = 0; i < siglen && res; i++) res = (ksign[i] & ~qsign[i]) == 0;
+				}
+				pfree(qsign);
+			}
+			break;
+		default:
+			elog(ERROR, "unrecognized strategy number: %d", strategy);
+	}
+	return res;
+}
+
+
+/*****************************************************************************
+ * BRIN support
+ *
+ * Every block range keeps the smallest and the largest element of the sets
+ * in it (as integers, compared as unsigned ones) and a bloom filter of the
+ * elements. A block range with only empty sets has min > max.
+ *****************************************************************************/
+
+PG_FUNCTION_INFO_V1(intset_brin_opcinfo);
+
+Datum
+intset_brin_opcinfo(PG_FUNCTION_ARGS)
+{
+	BrinOpcInfo *result = (BrinOpcInfo *) palloc0(SizeofBrinOpcInfo(3));
+
+	result->oi_nstored = 3;
+	result->oi_typcache[BRIN_MIN] = lookup_type_cache(INT4OID, 0);
+	result->oi_typcache[BRIN_MAX] = lookup_type_cache(INT4OID, 0);
+	result->oi_typcache[BRIN_BLOOM] = lookup_type_cache(BYTEAOID, 0);
+	PG_RETURN_POINTER(result);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_brin_add_value);
+
+Datum
+intset_brin_add_value(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	Datum newval = PG_GETARG_DATUM(2);
+	bool isnull = PG_GETARG_BOOL(3);
+	intSet *a;
+	uint32 *anums, asize, min, max;
+	bytea *bloom;
+	bool updated = false;
+
+	if (isnull) {
+		if (column->bv_hasnulls) PG_RETURN_BOOL(false);
+		column->bv_hasnulls = true;
+		PG_RETURN_BOOL(true);
+	}
+
+	// the first set of the range starts an empty summary
+	if (column->bv_allnulls) {
+		bloom = (bytea *) palloc0(VARHDRSZ + BLOOM_BYTES);
+		SET_VARSIZE(bloom, VARHDRSZ + BLOOM_BYTES);
+		column->bv_values[BRIN_MIN] = UInt32GetDatum(PG_UINT32_MAX);
+		column->bv_values[BRIN_MAX] = UInt32GetDatum(0);
+		column->bv_values[BRIN_BLOOM] = PointerGetDatum(bloom);
+		column->bv_allnulls = false;
+		updated = true;
+	}
+
+	a = DatumGetIntSetP(newval);
+	anums = (uint32 *) VARDATA_ANY(a);
+	asize = VARSIZE_ANY_EXHDR(a) / 4;
+	if (asize == 0) PG_RETURN_BOOL(updated);
+
+	min = DatumGetUInt32(column->bv_values[BRIN_MIN]);
+	max = DatumGetUInt32(column->bv_values[BRIN_MAX]);
+	if (anums[0] < min) column->bv_values[BRIN_MIN] = UInt32GetDatum(anums[0]);
+	if (anums[asize - 1] > max) column->bv_values[BRIN_MAX] = UInt32GetDatum(anums[asize - 1]);
+	updated |= anums[0] < min || anums[asize - 1] > max;
+
+	// the summary owns its filter, so it is changed in place
+	bloom = (bytea *) PG_DETOAST_DATUM(column->bv_values[BRIN_BLOOM]);
+	for (uint32 i = 0; i < asize; i++) {
+		if (bloomAdd(VARDATA(bloom), anums[i])) updated = true;
+	}
+	column->bv_values[BRIN_BLOOM] = PointerGetDatum(bloom);
+
+	if ((Pointer) a != DatumGetPointer(newval)) pfree(a);
+	PG_RETURN_BOOL(updated);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_brin_consistent);
+
+Datum
+intset_brin_consistent(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	ScanKey key = (ScanKey) PG_GETARG_POINTER(2);
+	uint32 min, max, single, *qnums, qsize;
+	char *bloom;
+	intSet *q;
+	bool res;
+
+	// IS NULL and IS NOT NULL
+	if (key->sk_flags & SK_ISNULL) {
+		if (key->sk_flags & SK_SEARCHNULL) PG_RETURN_BOOL(column->bv_allnulls || column->bv_hasnulls);
+		if (key->sk_flags & SK_SEARCHNOTNULL) PG_RETURN_BOOL(!column->bv_allnulls);
+		PG_RETURN_BOOL(false);
+	}
+	if (column->bv_allnulls) PG_RETURN_BOOL(false);
+
+	min = DatumGetUInt32(column->bv_values[BRIN_MIN]);
+	max = DatumGetUInt32(column->bv_values[BRIN_MAX]);
+	bloom = VARDATA_ANY(DatumGetPointer(column->bv_values[BRIN_BLOOM]));
+
+	if (key->sk_strategy == INTSET_HAS_STRATEGY) {
+		// the integer is read as unsigned, the way the operator reads it
+		single = DatumGetUInt32(key->sk_argument);
+		PG_RETURN_BOOL(single >= min && single <= max && bloomMayContain(bloom, single));
+	}
+
+	q = DatumGetIntSetP(key->sk_argument);
+	qnums = (uint32 *) VARDATA_ANY(q);
+	qsize = VARSIZE_ANY_EXHDR(q) / 4;
+
+	switch (key->sk_strategy) {
+		case INTSET_OVERLAP_STRATEGY:
+			// some query element must be in the span and the filter
+			res = false;
+			for (uint32 i = lowerBound(qnums, qsize, min); i < qsize && qnums[i] <= max && !res; i++) {
+				res = bloomMayContain(bloom, qnums[i]);
+			}
+			break;
+		case INTSET_CONTAINS_STRATEGY:
+			// every query element must be in the span and the filter
+			if (qsize == 0) {
+				res = true;
+				break;
+			}
+			res = qnums[0] >= min && qnums[qsize - 1] <= max;
+			for (uint32 i = 0; i < qsize && res; i++) res = bloomMayContain(bloom, qnums[i]);
+			break;
+		default:
+			elog(ERROR, "unrecognized strategy number: %d", key->sk_strategy);
+			res = false;
+	}
+	PG_RETURN_BOOL(res);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_brin_union);
+
+Datum
+intset_brin_union(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	BrinValues *col_a = (BrinValues *) PG_GETARG_POINTER(1);
+	BrinValues *col_b = (BrinValues *) PG_GETARG_POINTER(2);
+	bytea *bloom_a, *bloom_b;
+
+	if (col_b->bv_hasnulls) col_a->bv_hasnulls = true;
+	// B has no sets, nothing to add
+	if (col_b->bv_allnulls) PG_RETURN_VOID();
+
+	// A has no sets, it gets a copy of B's summary
+	if (col_a->bv_allnulls) {
+		col_a->bv_allnulls = false;
+		col_a->bv_values[BRIN_MIN] = col_b->bv_values[BRIN_MIN];
+		col_a->bv_values[BRIN_MAX] = col_b->bv_values[BRIN_MAX];
+		col_a->bv_values[BRIN_BLOOM] = datumCopy(col_b->bv_values[BRIN_BLOOM], false, -1);
+		PG_RETURN_VOID();
+	}
+
+	if (DatumGetUInt32(col_b->bv_values[BRIN_MIN]) < DatumGetUInt32(col_a->bv_values[BRIN_MIN]))
+		col_a->bv_values[BRIN_MIN] = col_b->bv_values[BRIN_MIN];
+	if (DatumGetUInt32(col_b->bv_values[BRIN_MAX]) > DatumGetUInt32(col_a->bv_values[BRIN_MAX]))
+		col_a->bv_values[BRIN_MAX] = col_b->bv_values[BRIN_MAX];
+
+	bloom_a = (bytea *) PG_DETOAST_DATUM(col_a->bv_values[BRIN_BLOOM]);
+	bloom_b = (bytea *) PG_DETOAST_DATUM(col_b->bv_values[BRIN_BLOOM]);
+	for (int i = 0; i < BLOOM_BYTES; i++) VARDATA(bloom_a)[i] |= VARDATA(bloom_b)[i];
+	col_a->bv_values[BRIN_BLOOM] = PointerGetDatum(bloom_a);
+	PG_RETURN_VOID();
+}
+
+
+/*****************************************************************************
+ * SP-GiST support
+ *
+ * A k-d tree over the span of every set, as the point (min, max). The empty
+ * set is the point (+inf, -inf), which is within every range and overlaps
+ * none. Inner tuples split on min at even levels and on max at odd levels:
+ * node 0 holds the points with a coordinate <= the prefix, node 1 those >= it.
+ *****************************************************************************/
+
+struct spanSortItem {
+	float8 v;			// the coordinate the split is on
+	int i;				// the index of the point in the input
+};
+typedef struct spanSortItem spanSortItem;
+
+static int spanSortCmp(const void *a, const void *b) {
+	float8 x = ((const spanSortItem *) a)->v;
+	float8 y = ((const spanSortItem *) b)->v;
+
+	if (x == y) return 0;
+	return (x < y) ? -1 : 1;
+}
+
+PG_FUNCTION_INFO_V1(intset_spg_config);
+
+Datum
+intset_spg_config(PG_FUNCTION_ARGS)
+{
+	spgConfigOut *cfg = (spgConfigOut *) PG_GETARG_POINTER(1);
+
+	cfg->prefixType = FLOAT8OID;
+	cfg->labelType = VOIDOID;		// the nodes have no labels
+	cfg->leafType = POINTOID;
+	cfg->canReturnData = false;		// a set can't be rebuilt from its span
+	cfg->longValuesOK = false;
+	PG_RETURN_VOID();
+}
+
+
+PG_FUNCTION_INFO_V1(intset_spg_compress);
+
+Datum
+intset_spg_compress(PG_FUNCTION_ARGS)
+{
+	/*
+		Given a intSet A
+		this func returns
+			the point (min, max) of A that is kept in the leaf
+	*/
+	// declare everthing on top to make gcc happy
+	intSet *a = DatumGetIntSetP(PG_GETARG_DATUM(0));
+	Point *p = (Point *) palloc(sizeof(Point));
+
+	numsSpan((uint32 *) VARDATA_ANY(a), VARSIZE_ANY_EXHDR(a) / 4, &p->x, &p->y);
+	if ((Pointer) a != PG_GETARG_POINTER(0)) pfree(a);
+	PG_RETURN_POINTER(p);
+}
+
+
+PG_FUNCTION_INFO_V1(intset_spg_choose);
+
+Datum
+intset_spg_choose(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	spgChooseIn *in = (spgChooseIn *) PG_GETARG_POINTER(0);
+	spgChooseOut *out = (spgChooseOut *) PG_GETARG_POINTER(1);
+	Point *p = DatumGetPointP(in->leafDatum);
+	float8 coord = DatumGetFloat8(in->prefixDatum);
+	float8 v = (in->level % 2 == 0) ? p->x : p->y;
+
+	out->resultType = spgMatchNode;
+	// the core picks the node itself for an allTheSame tuple
+	out->result.matchNode.nodeN = (v < coord) ? 0 : 1;
+	out->result.matchNode.levelAdd = 1;
+	out->result.matchNode.restDatum = PointPGetDatum(p);
+	PG_RETURN_VOID();
+}
+
+
+PG_FUNCTION_INFO_V1(intset_spg_picksplit);
+
+Datum
+intset_spg_picksplit(PG_FUNCTION_ARGS)
+{
+	/*
+		splits the points at the median of the coordinate of this level, the
+		lower half goes to node 0 and the rest to node 1
+	*/
+	// declare everthing on top to make gcc happy
+	spgPickSplitIn *in = (spgPickSplitIn *) PG_GETARG_POINTER(0);
+	spgPickSplitOut *out = (spgPickSplitOut *) PG_GETARG_POINTER(1);
+	spanSortItem *sorted = (spanSortItem *) palloc(in->nTuples * sizeof(spanSortItem));
+	int middle = in->nTuples / 2;
+	Point *p;
+
+	for (int i = 0; i < in->nTuples; i++) {
+		p = DatumGetPointP(in->datums[i]);
+		sorted[i].v = (in->level % 2 == 0) ? p->x : p->y;
+		sorted[i].i = i;
+	}
+	qsort(sorted, in->nTuples, sizeof(spanSortItem), spanSortCmp);
+
+	out->hasPrefix = true;
+	out->prefixDatum = Float8GetDatum(sorted[middle].v);
+	out->nNodes = 2;
+	out->nodeLabels = NULL;
+	out->mapTuplesToNodes = (int *) palloc(in->nTuples * sizeof(int));
+	out->leafTupleDatums = (Datum *) palloc(in->nTuples * sizeof(Datum));
+	for (int i = 0; i < in->nTuples; i++) {
+		out->mapTuplesToNodes[sorted[i].i] = (i < middle) ? 0 : 1;
+		out->leafTupleDatums[sorted[i].i] = in->datums[sorted[i].i];
+	}
+	pfree(sorted);
+	PG_RETURN_VOID();
+}
+
+
+PG_FUNCTION_INFO_V1(intset_spg_inner_consistent);
+
+Datum
+intset_spg_inner_consistent(PG_FUNCTION_ARGS)
+{
+	/*
+		node 0 only has coordinates <= coord and node 1 only >= coord,
+		a node is skipped if no point on its side can satisfy every key
+	*/
+	// declare everthing on top to make gcc happy
+	spgInnerConsistentIn *in = (spgInnerConsistentIn *) PG_GETARG_POINTER(0);
+	spgInnerConsistentOut *out = (spgInnerConsistentOut *) PG_GETARG_POINTER(1);
+	float8 coord = DatumGetFloat8(in->prefixDatum), lo, hi;
+	bool onMin = (in->level % 2 == 0);
+	bool node0 = true, node1 = true;
+	StrategyNumber strategy;
+
+	for (int i = 0; i < in->nkeys && (node0 || node1); i++) {
+		strategy = in->scankeys[i].sk_strategy;
+		if (!spanQuery(DatumGetRangeTypeP(in->scankeys[i].sk_argument), strategy, &lo, &hi)) {
+			node0 = node1 = false;
+			break;
+		}
+		switch (strategy) {
+			case INTSET_SPAN_WITHIN_STRATEGY:
+				// needs min >= lo and max <= hi
+				if (onMin && coord < lo) node0 = false;
+				if (!onMin && coord > hi) node1 = false;
+				break;
+			case INTSET_SPAN_OVERLAP_STRATEGY:
+			case INTSET_OVERLAP_RANGE_STRATEGY:
+				// needs min <= hi and max >= lo
+				if (onMin && coord > hi) node1 = false;
+				if (!onMin && coord < lo) node0 = false;
+				break;
+			default:
+				elog(ERROR, "unrecognized strategy number: %d", strategy);
+		}
+	}
+
+	out->nNodes = 0;
+	out->nodeNumbers = (int *) palloc(in->nNodes * sizeof(int));
+	out->levelAdds = (int *) palloc(in->nNodes * sizeof(int));
+	for (int i = 0; i < in->nNodes; i++) {
+		// the nodes of an allTheSame tuple don't split anything
+		if (in->allTheSame ? (node0 || node1) : (i == 0 ? node0 : node1)) {
+			out->nodeNumbers[out->nNodes] = i;
+			out->levelAdds[out->nNodes] = 1;
+			out->nNodes++;
+		}
+	}
+	PG_RETURN_VOID();
+}
+
+
+PG_FUNCTION_INFO_V1(intset_spg_leaf_consistent);
+
+Datum
+intset_spg_leaf_consistent(PG_FUNCTION_ARGS)
+{
+	/*
+		the span answers <@ and <&> exactly, for &&> it is only a prefilter
+		and the set is checked again
+	*/
+	// declare everthing on top to make gcc happy
+	spgLeafConsistentIn *in = (spgLeafConsistentIn *) PG_GETARG_POINTER(0);
+	spgLeafConsistentOut *out = (spgLeafConsistentOut *) PG_GETARG_POINTER(1);
+	Point *p = DatumGetPointP(in->leafDatum);
+	StrategyNumber strategy;
+	float8 lo, hi;
+
+	out->recheck = false;
+	for (int i = 0; i < in->nkeys; i++) {
+		strategy = in->scankeys[i].sk_strategy;
+		if (!spanQuery(DatumGetRangeTypeP(in->scankeys[i].sk_argument), strategy, &lo, &hi) ||
+			!spanConsistent(p->x, p->y, lo, hi, strategy))
+			PG_RETURN_BOOL(false);
+		if (strategy == INTSET_OVERLAP_RANGE_STRATEGY) out->recheck = true;
+	}
+	PG_RETURN_BOOL(true);
+}
+
+
+/*****************************************************************************
+ * Planner support
+ *
+ * intset_support is the support function of the functions that take sets.
+ * It gives the planner the cost of a call from the number of elements of its
+ * arguments (exact for constants, from the statistics for columns), the
+ * number of rows of intset_elements, and the index conditions a call can be
+ * answered with: the matching operator for an index on a set, so that
+ * intset_contain_all(s, '{1,2}') can use a GIN or GiST index on s just like
+ * s >@ '{1,2}' does, and the span of a constant set for a btree index on an
+ * integer, so that intset_contains(i, '{3,5,9}') scans i between 3 and 9.
+ * It also simplifies calls: A || '{}', A - '{}' and A !! '{}' are just A,
+ * nested unions and intersections become one intset_union_all or
+ * intset_intersect_all call over all of their operands, and the constant
+ * operands of those are combined into one set once, at plan time. Finally,
+ * id ? S on a partitioned table is given conditions on id the partition
+ * pruner understands, by a planner hook that goes over the query once before
+ * it is planned (see pruneMembership).
+ *****************************************************************************/
+
+PG_FUNCTION_INFO_V1(intset_support);
+
+Datum
+intset_support(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	Node *rawreq = (Node *) PG_GETARG_POINTER(0);
+	Node *ret = NULL;
+	List *args;
+
+	if (IsA(rawreq, SupportRequestCost)) {
+		SupportRequestCost *req = (SupportRequestCost *) rawreq;
+		// without the call there are no arguments to go by, so procost it is
+		if (req->node != NULL) {
+			req->startup = 0;
+			req->per_tuple = cpu_operator_cost * callCost(req->root, req->funcid, callArgs(req->node));
+			ret = (Node *) req;
+		}
+	} else if (IsA(rawreq, SupportRequestRows)) {
+		SupportRequestRows *req = (SupportRequestRows *) rawreq;
+		// intset_elements is the only set returning function,
+		// it returns a row per element of its set
+		if (req->node != NULL) {
+			args = callArgs(req->node);
+			if (list_length(args) >= 1) {
+				req->rows = Max(1.0, argSize(req->root, (Node *) linitial(args), setType(req->funcid)));
+				ret = (Node *) req;
+			}
+		}
+	} else if (IsA(rawreq, SupportRequestIndexCondition)) {
+		SupportRequestIndexCondition *req = (SupportRequestIndexCondition *) rawreq;
+		ret = (Node *) indexCondition(req);
+	} else if (IsA(rawreq, SupportRequestSimplify)) {
+		SupportRequestSimplify *req = (SupportRequestSimplify *) rawreq;
+		ret = simplifyCall(req->root, req->fcall);
+	}
+	PG_RETURN_POINTER(ret);
+}
+
+static planner_hook_type prevPlanner = NULL;
+
+#if PG_VERSION_NUM >= 130000
+static PlannedStmt *
+intset_planner(Query *parse, const char *query_string, int cursorOptions, ParamListInfo boundParams)
+#else
+static PlannedStmt *
+intset_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
+#endif
+{
+	// the query is planned from here on, so this is the one time it is
+	// gone over before the partitions are pruned
+	pruneQuery(parse);
+#if PG_VERSION_NUM >= 130000
+	if (prevPlanner != NULL) return prevPlanner(parse, query_string, cursorOptions, boundParams);
+	return standard_planner(parse, query_string, cursorOptions, boundParams);
+#else
+	if (prevPlanner != NULL) return prevPlanner(parse, cursorOptions, boundParams);
+	return standard_planner(parse, cursorOptions, boundParams);
+#endif
+}
+
+
+/*****************************************************************************
+ * Custom scan
+ *
+ * For WHERE id ? $1 (or $1 ? id, or intset_contains(id, $1)) on an integer
+ * column with a btree index, the IntSet Index Probe scan walks the elements
+ * of the set in order and looks each of them up in the index, instead of
+ * checking the set for every row of the table. As the set is sorted, the
+ * rows come out in the order of the index. The planner picks it on cost;
+ * SET intset.enable_customscan = off keeps it from being considered at all.
+ *****************************************************************************/
+
+void _PG_init(void);
+static void intset_set_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, Index rti,
+									RangeTblEntry *rte);
+static Plan *intset_plan_custom_path(PlannerInfo *root, RelOptInfo *rel, CustomPath *best_path,
+									 List *tlist, List *clauses, List *custom_plans);
+static Node *intset_create_scan_state(CustomScan *cscan);
+static void intset_begin_scan(CustomScanState *node, EState *estate, int eflags);
+static TupleTableSlot *intset_exec_scan(CustomScanState *node);
+static TupleTableSlot *intset_scan_next(ScanState *ss);
+static bool intset_scan_recheck(ScanState *ss, TupleTableSlot *slot);
+static void intset_end_scan(CustomScanState *node);
+static void intset_rescan_scan(CustomScanState *node);
+static void intset_explain_scan(CustomScanState *node, List *ancestors, ExplainState *es);
+
+static bool enableCustomScan = true;
+static set_rel_pathlist_hook_type prevSetRelPathlist = NULL;
+
+static const CustomPathMethods intsetPathMethods = {
+	.CustomName = "IntSet Index Probe",
+	.PlanCustomPath = intset_plan_custom_path,
+};
+
+static const CustomScanMethods intsetScanMethods = {
+	.CustomName = "IntSet Index Probe",
+	.CreateCustomScanState = intset_create_scan_state,
+};
+
+static const CustomExecMethods intsetExecMethods = {
+	.CustomName = "IntSet Index Probe",
+	.BeginCustomScan = intset_begin_scan,
+	.ExecCustomScan = intset_exec_scan,
+	.EndCustomScan = intset_end_scan,
+	.ReScanCustomScan = intset_rescan_scan,
+	.ExplainCustomScan = intset_explain_scan,
+};
+
+void
+_PG_init(void)
+{
+	DefineCustomBoolVariable("intset.enable_customscan",
+							 "Enables the planner's use of index probes driven by an intset.",
+							 NULL,
+							 &enableCustomScan,
+							 true,
+							 PGC_USERSET,
+							 0,
+							 NULL, NULL, NULL);
+	RegisterCustomScanMethods(&intsetScanMethods);
+	prevSetRelPathlist = set_rel_pathlist_hook;
+	set_rel_pathlist_hook = intset_set_rel_pathlist;
+	prevPlanner = planner_hook;
+	planner_hook = intset_planner;
+}
+
+static void
+intset_set_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, Index rti, RangeTblEntry *rte)
+{
+	// declare everthing on top to make gcc happy
+	ListCell *lc;
+	RestrictInfo *rinfo;
+	IndexOptInfo *index;
+	CustomPath *cpath;
+	Var *var;
+	Node *set;
+
+	if (prevSetRelPathlist != NULL) prevSetRelPathlist(root, rel, rti, rte);
+	if (!enableCustomScan || !IS_SIMPLE_REL(rel) || rte->rtekind != RTE_RELATION ||
+		rte->relkind != RELKIND_RELATION || rte->inh || rte->tablesample != NULL)
+		return;
+
+	// a path for every "column ? set" clause there is an index for
+	foreach(lc, rel->baserestrictinfo) {
+		rinfo = (RestrictInfo *) lfirst(lc);
+		if (!probeClause(rel, rinfo, &var, &set)) continue;
+		index = probeIndex(rel, var);
+		if (index == NULL) continue;
+
+		cpath = makeNode(CustomPath);
+		cpath->path.pathtype = T_CustomScan;
+		cpath->path.parent = rel;
+		cpath->path.pathtarget = rel->reltarget;
+		cpath->path.param_info = get_baserel_parampathinfo(root, rel, rel->lateral_relids);
+		cpath->path.parallel_aware = false;
+		cpath->path.parallel_safe = rel->consider_parallel;
+		cpath->path.parallel_workers = 0;
+		cpath->path.rows = cpath->path.param_info ? cpath->path.param_info->ppi_rows : rel->rows;
+		// the elements are probed in ascending order, so a descending
+		// first column gives no useful order
+		cpath->path.pathkeys = index->reverse_sort[0] ?
+			NIL : build_index_pathkeys(root, index, ForwardScanDirection);
+		probeCost(root, rel, rinfo, index, set, &cpath->path);
+		cpath->flags = 0;
+		cpath->custom_paths = NIL;
+		cpath->custom_private = list_make2(list_make1_oid(index->indexoid), set);
+		cpath->methods = &intsetPathMethods;
+		add_path(rel, (Path *) cpath);
+	}
+}
+
+static Plan *
+intset_plan_custom_path(PlannerInfo *root, RelOptInfo *rel, CustomPath *best_path,
+						List *tlist, List *clauses, List *custom_plans)
+{
+	// declare everthing on top to make gcc happy
+	CustomScan *cscan = makeNode(CustomScan);
+
+	cscan->scan.plan.targetlist = tlist;
+	// the probed clause stays among the quals, so rows given to the scan by
+	// EvalPlanQual are checked against it as well
+	cscan->scan.plan.qual = extract_actual_clauses(clauses, false);
+	cscan->scan.scanrelid = rel->relid;
+	cscan->flags = best_path->flags;
+	cscan->custom_plans = NIL;
+	cscan->custom_exprs = list_make1(lsecond(best_path->custom_private));
+	cscan->custom_private = (List *) linitial(best_path->custom_private);
+	cscan->custom_scan_tlist = NIL;
+	cscan->methods = &intsetScanMethods;
+	return (Plan *) cscan;
+}
+
+static Node *
+intset_create_scan_state(CustomScan *cscan)
+{
+	// declare everthing on top to make gcc happy
+	intSetScanState *state = (intSetScanState *) palloc0(sizeof(intSetScanState));
+
+	NodeSetTag(state, T_CustomScanState);
+	state->css.methods = &intsetExecMethods;
+	return (Node *) state;
+}
+
+static void
+intset_begin_scan(CustomScanState *node, EState *estate, int eflags)
+{
+	// declare everthing on top to make gcc happy
+	intSetScanState *state = (intSetScanState *) node;
+	CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+
+	state->index = index_open(linitial_oid(cscan->custom_private), AccessShareLock);
+	state->setExpr = ExecInitExpr((Expr *) linitial(cscan->custom_exprs), &node->ss.ps);
+	state->scan = NULL;
+	state->set = NULL;
+	state->started = false;
+}
+
+static TupleTableSlot *
+intset_exec_scan(CustomScanState *node)
+{
+	return ExecScan(&node->ss, (ExecScanAccessMtd) intset_scan_next,
+					(ExecScanRecheckMtd) intset_scan_recheck);
+}
+
+// the next row whose column is an element of the set: the rows of the
+// element being probed, then those of the next element, and so on, in the
+// order of the integers (see probeStart)
+static TupleTableSlot *
+intset_scan_next(ScanState *ss)
+{
+	// declare everthing on top to make gcc happy
+	intSetScanState *state = (intSetScanState *) ss;
+	TupleTableSlot *slot = ss->ss_ScanTupleSlot;
+	uint32 size;
+
+	if (!state->started) {
+		state->started = true;
+		if (!probeStart(state)) return ExecClearTuple(slot);
+	}
+	if (state->set == NULL) return ExecClearTuple(slot);
+
+	size = VARSIZE_ANY_EXHDR(state->set) / 4;
+	while (!index_getnext_slot(state->scan, ForwardScanDirection, slot)) {
+		if (state->pos + 1 >= size) return ExecClearTuple(slot);
+		state->pos++;
+		state->key.sk_argument = probeKey(state);
+		index_rescan(state->scan, &state->key, 1, NULL, 0);
+	}
+	return slot;
+}
+
+// a row EvalPlanQual gives back to the scan only has to pass the quals,
+// which ExecScan checks
+static bool
+intset_scan_recheck(ScanState *ss, TupleTableSlot *slot)
+{
+	return true;
+}
+
+static void
+intset_end_scan(CustomScanState *node)
+{
+	// declare everthing on top to make gcc happy
+	intSetScanState *state = (intSetScanState *) node;
+
+	if (state->scan != NULL) index_endscan(state->scan);
+	if (state->index != NULL) index_close(state->index, NoLock);
+}
+
+static void
+intset_rescan_scan(CustomScanState *node)
+{
+	// declare everthing on top to make gcc happy
+	intSetScanState *state = (intSetScanState *) node;
+
+	// the set may depend on parameters that have changed, so it is
+	// evaluated again by the next fetch
+	if (state->set != NULL) pfree(state->set);
+	state->set = NULL;
+	state->started = false;
+}
+
+static void
+intset_explain_scan(CustomScanState *node, List *ancestors, ExplainState *es)
+{
+	// declare everthing on top to make gcc happy
+	intSetScanState *state = (intSetScanState *) node;
+
+	ExplainPropertyText("Index Name", RelationGetRelationName(state->index), es);
+	if (es->analyze && state->set != NULL)
+		ExplainPropertyInteger("Probes", NULL, state->pos + 1, es);
+}
+
+
+/*****************************************************************************
+ * ANALYZE support
+ *
+ * On top of the standard statistics of the column, ANALYZE finds the most
+ * common elements of the sets with Lossy Counting (as array_typanalyze does),
+ * a histogram of the set sizes and the number of distinct elements, for the
+ * selectivity estimators below.
+ *****************************************************************************/
+
+static void intset_compute_stats(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfunc,
+								 int samplerows, double totalrows);
+static int elemTrackFreqCmp(const void *a, const void *b);
+static int elemTrackElemCmp(const void *a, const void *b);
+
+PG_FUNCTION_INFO_V1(intset_typanalyze);
+
+Datum
+intset_typanalyze(PG_FUNCTION_ARGS)
+{
+	// declare everthing on top to make gcc happy
+	VacAttrStats *stats = (VacAttrStats *) PG_GETARG_POINTER(0);
+	analyzeExtra *extra;
+
+	// the standard statistics (with the default btree operators) come first
+	if (!std_typanalyze(stats)) PG_RETURN_BOOL(false);
+
+	extra = (analyzeExtra *) palloc(sizeof(analyzeExtra));
+	extra->stdComputeStats = stats->compute_stats;
+	extra->stdExtraData = stats->extra_data;
+	stats->compute_stats = intset_compute_stats;
+	stats->extra_data = extra;
+	PG_RETURN_BOOL(true);
+}
+
+static void intset_compute_stats(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfunc,
+								 int samplerows, double totalrows) {
+	analyzeExtra *extra = (analyzeExtra *) stats->extra_data;
+	int numMce = stats->attr->attstattarget * 10;
+	int numHist = Max(stats->attr->attstattarget, 2);
+	// the same bucket width as array_typanalyze
+	int64 bucketWidth = numMce * 1000 / 7;
+	int64 elementNo = 0, cutoff, total = 0;
+	int bucket = 1, analyzedRows = 0, nsorted = 0, slot = 0, minfreq, maxfreq;
+	uint32 *counts, *anums, asize, stride;
+	HASHCTL ctl;
+	HTAB *elements;
+	HASH_SEQ_STATUS scan;
+	hyperLogLogState distinct;
+	elemTrack *item, **sorted;
+	MemoryContext old;
+	Datum value, *mceValues;
+	float4 *mceFreqs, *hist;
+	bool isnull, found;
+	intSet *a;
+
+	// the standard statistics, with their own extra data
+	stats->extra_data = extra->stdExtraData;
+	extra->stdComputeStats(stats, fetchfunc, samplerows, totalrows);
+	stats->extra_data = extra;
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(uint32);
+	ctl.entrysize = sizeof(elemTrack);
+	ctl.hcxt = CurrentMemoryContext;
+	elements = hash_create("intset analyzed elements", numMce, &ctl,
+						   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	initHyperLogLog(&distinct, 10);
+	counts = (uint32 *) palloc(samplerows * sizeof(uint32));
+
+	for (int i = 0; i < samplerows; i++) {
+		vacuum_delay_point();
+		value = fetchfunc(stats, i, &isnull);
+		if (isnull) continue;
+
+		a = DatumGetIntSetP(value);
+		anums = (uint32 *) VARDATA_ANY(a);
+		asize = VARSIZE_ANY_EXHDR(a) / 4;
+		counts[analyzedRows++] = asize;
+		total += asize;
+
+		// the elements of a set are distinct, so each is one more row;
+		// a large set only has every stride-th element counted (from a
+		// random one of the first stride), stride times each
+		stride = Max(1, (asize + ANALYZE_MAX_ELEMS - 1) / ANALYZE_MAX_ELEMS);
+		for (uint32 j = (stride > 1) ? (uint32) random() % stride : 0; j < asize; j += stride) {
+			item = (elemTrack *) hash_search(elements, &anums[j], HASH_ENTER, &found);
+			if (found) {
+				item->frequency += stride;
+			} else {
+				item->frequency = stride;
+				item->delta = bucket - 1;
+			}
+			addHyperLogLog(&distinct, DatumGetUInt32(hash_uint32(anums[j])));
+
+			// at the end of a bucket, drop the elements that can't be common
+			elementNo += stride;
+			if (elementNo / bucketWidth >= bucket) {
+				bucket = elementNo / bucketWidth + 1;
+				pruneElements(elements, bucket - 1);
+			}
+		}
+		if ((Pointer) a != DatumGetPointer(value)) pfree(a);
+	}
+
+	if (analyzedRows > 0) {
+		// our slots go after the standard ones
+		while (slot < STATISTIC_NUM_SLOTS && stats->stakind[slot] != 0) slot++;
+		if (slot > STATISTIC_NUM_SLOTS - 2)
+			elog(ERROR, "insufficient pg_statistic slots for intset stats");
+
+		// the elements seen more often than the error bound of Lossy Counting,
+		// the numMce most common of them if there are more
+		cutoff = 9 * elementNo / bucketWidth;
+		sorted = (elemTrack **) palloc(Max(1, hash_get_num_entries(elements)) * sizeof(elemTrack *));
+		hash_seq_init(&scan, elements);
+		while ((item = (elemTrack *) hash_seq_search(&scan)) != NULL) {
+			if (item->frequency > cutoff) sorted[nsorted++] = item;
+		}
+		if (nsorted > numMce) {
+			qsort(sorted, nsorted, sizeof(elemTrack *), elemTrackFreqCmp);
+			nsorted = numMce;
+		}
+
+		if (nsorted > 0) {
+			// a sampled element can be counted more times than there are rows
+			minfreq = maxfreq = Min(sorted[0]->frequency, analyzedRows);
+			for (int i = 0; i < nsorted; i++) {
+				sorted[i]->frequency = Min(sorted[i]->frequency, analyzedRows);
+				minfreq = Min(minfreq, sorted[i]->frequency);
+				maxfreq = Max(maxfreq, sorted[i]->frequency);
+			}
+			// the estimators look the elements up in ascending order
+			qsort(sorted, nsorted, sizeof(elemTrack *), elemTrackElemCmp);
+
+			old = MemoryContextSwitchTo(stats->anl_context);
+			mceValues = (Datum *) palloc(nsorted * sizeof(Datum));
+			mceFreqs = (float4 *) palloc((nsorted + 3) * sizeof(float4));
+			for (int i = 0; i < nsorted; i++) {
+				mceValues[i] = Int32GetDatum((int32) sorted[i]->elem);
+				mceFreqs[i] = (float4) sorted[i]->frequency / analyzedRows;
+			}
+			// min, max and null element frequencies, as for arrays
+			mceFreqs[nsorted] = (float4) minfreq / analyzedRows;
+			mceFreqs[nsorted + 1] = (float4) maxfreq / analyzedRows;
+			mceFreqs[nsorted + 2] = 0.0;
+			MemoryContextSwitchTo(old);
+
+			stats->stakind[slot] = STATISTIC_KIND_MCELEM;
+			stats->staop[slot] = Int4EqualOperator;
+			stats->stacoll[slot] = InvalidOid;
+			stats->stanumbers[slot] = mceFreqs;
+			stats->numnumbers[slot] = nsorted + 3;
+			stats->stavalues[slot] = mceValues;
+			stats->numvalues[slot] = nsorted;
+			stats->statypid[slot] = INT4OID;
+			stats->statyplen[slot] = sizeof(int32);
+			stats->statypbyval[slot] = true;
+			stats->statypalign[slot] = 'i';
+			slot++;
+		}
+		pfree(sorted);
+
+		// an equi-depth histogram of the set sizes, then the average size
+		// and the number of distinct elements (in the sample)
+		radixSort(counts, analyzedRows);
+		old = MemoryContextSwitchTo(stats->anl_context);
+		hist = (float4 *) palloc((numHist + 2) * sizeof(float4));
+		for (int i = 0; i < numHist; i++)
+			hist[i] = counts[(int64) i * (analyzedRows - 1) / (numHist - 1)];
+		hist[numHist] = (float4) total / analyzedRows;
+		hist[numHist + 1] = estimateHyperLogLog(&distinct);
+		MemoryContextSwitchTo(old);
+
+		stats->stakind[slot] = STATISTIC_KIND_DECHIST;
+		stats->staop[slot] = Int4EqualOperator;
+		stats->stacoll[slot] = InvalidOid;
+		stats->stanumbers[slot] = hist;
+		stats->numnumbers[slot] = numHist + 2;
+	}
+
+	freeHyperLogLog(&distinct);
+	hash_destroy(elements);
+	pfree(counts);
+}
+
+// the most frequent first
+static int elemTrackFreqCmp(const void *a, const void *b) {
+	const elemTrack *x = *((const elemTrack * const *) a);
+	const elemTrack *y = *((const elemTrack * const *) b);
+
+	return y->frequency - x->frequency;
+}
+
+// in ascending (unsigned) order of the elements
+static int elemTrackElemCmp(const void *a, const void *b) {
+	const elemTrack *x = *((const elemTrack * const *) a);
+	const elemTrack *y = *((const elemTrack * const *) b);
+
+	if (x->elem == y->elem) return 0;
+	return (x->elem < y->elem) ? -1 : 1;
+}
+
+
+/*****************************************************************************
+ * Selectivity estimation
+ *
+ * The restriction and join estimators of the operators, from the most common
+ * elements of the columns and the histograms of their set sizes when ANALYZE
+ * has gathered them. Elements are assumed to appear independently of each
+ * other.
+ *****************************************************************************/
+
+PG_FUNCTION_INFO_V1(intset_hassel);
+
+Datum
+intset_hassel(PG_FUNCTION_ARGS)
+{
+	// ? in either direction
+	PG_RETURN_FLOAT8(restrictSel(fcinfo, INTSET_HAS_STRATEGY, false));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_overlapsel);
+
+Datum
+intset_overlapsel(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_FLOAT8(restrictSel(fcinfo, INTSET_OVERLAP_STRATEGY, false));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_containssel);
+
+Datum
+intset_containssel(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_FLOAT8(restrictSel(fcinfo, INTSET_CONTAINS_STRATEGY, false));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_containedsel);
+
+Datum
+intset_containedsel(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_FLOAT8(restrictSel(fcinfo, INTSET_CONTAINED_STRATEGY, false));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_eqsel);
+
+Datum
+intset_eqsel(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_FLOAT8(restrictSel(fcinfo, INTSET_EQUAL_STRATEGY, false));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_neqsel);
+
+Datum
+intset_neqsel(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_FLOAT8(restrictSel(fcinfo, INTSET_EQUAL_STRATEGY, true));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_hasjoinsel);
+
+Datum
+intset_hasjoinsel(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_FLOAT8(joinSel(fcinfo, INTSET_HAS_STRATEGY, false));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_overlapjoinsel);
+
+Datum
+intset_overlapjoinsel(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_FLOAT8(joinSel(fcinfo, INTSET_OVERLAP_STRATEGY, false));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_containsjoinsel);
+
+Datum
+intset_containsjoinsel(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_FLOAT8(joinSel(fcinfo, INTSET_CONTAINS_STRATEGY, false));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_containedjoinsel);
+
+Datum
+intset_containedjoinsel(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_FLOAT8(joinSel(fcinfo, INTSET_CONTAINED_STRATEGY, false));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_eqjoinsel);
+
+Datum
+intset_eqjoinsel(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_FLOAT8(joinSel(fcinfo, INTSET_EQUAL_STRATEGY, false));
+}
+
+
+PG_FUNCTION_INFO_V1(intset_neqjoinsel);
+
+Datum
+intset_neqjoinsel(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_FLOAT8(joinSel(fcinfo, INTSET_EQUAL_STRATEGY, true));
+}
+
+
+
+/*
+    ---------------- Tree operations ----------------
+*/
+// this func create a new tree node
+TreeNode newNode(uint32_t n) {
+    TreeNode res = palloc(sizeof(struct treeNode));
+    res->data = n;
+    res->left = NULL;
+    res->right = NULL;
+    return res;
+}
+
+// computes the height of tree
+uint32_t treeHeight(TreeNode root) {
+	uint32_t left, right;
+	if (root == NULL) return 0;
+	left = treeHeight(root->left);
+	right = treeHeight(root->right);
+	return (left > right ? left : right) + 1;
+}
+
+
+TreeNode left_rotate(TreeNode root) {
+	TreeNode right = root->right;
+	TreeNode right_left = right->left;
+	right->left = root;
+	root->right = right_left;
+	return right;
+}
+
+
+TreeNode right_rotate(TreeNode root) {
+	TreeNode left = root->left;
+	TreeNode left_right = left->right;
+	left->right = root;
+	root->left = left_right;
+	return left;
+}
+
+
+// this func insert a new node into a nums tree
+TreeNode insertNode(uint32_t n, TreeNode root) {
+	int balanced;
+	if (root == NULL) return newNode(n);
+
+    if (n > root->data) root->right = insertNode(n, root->right);
     else if (n < root->data) root->left = insertNode(n, root->left);
 
-	// start to balance the tree 
-	balanced = treeHeight(root->left) - treeHeight(root->right);
-	if (balanced > 1) {
-		if (n < root->left->data) {
-			root = right_rotate(root);
+	// start to balance the tree 
+	balanced = treeHeight(root->left) - treeHeight(root->right);
+	if (balanced > 1) {
+		if (n < root->left->data) {
+			root = right_rotate(root);
+		} else {
+			root->left = left_rotate(root->left);
+			root = right_rotate(root);
+		}
+	} else if (balanced < -1) {
+		if (n > root->right->data) {
+			root = left_rotate(root);
+		} else {
+			root->right = right_rotate(root->right);
+			root = left_rotate(root);
+		}
+	}
+	return root;
+}
+
+
+// this func counts the number of nodes in a tree and return the result
+uint32_t treeSize(TreeNode root) {
+    if (root == NULL) return 0;
+    return treeSize(root->left) + treeSize(root->right) + 1;
+}
+
+
+// this function frees up the space used by the BST
+/*
+    given: a pointer to the root of the tree we want to destroy
+*/
+void destroyTree(TreeNode root) {
+    if (root == NULL) return;
+    destroyTree(root->left);
+    destroyTree(root->right);
+    pfree(root);
+}
+
+
+// see if 2 trees are identical
+bool treeEqual(TreeNode a, TreeNode b) {
+    
+    if (a == NULL && b == NULL) return true;
+    else if (a == NULL && b != NULL) return false;
+    else if (a != NULL && b == NULL) return false;
+    if (a->data != b->data) return false;
+    else return treeEqual(a->left, b->left) && treeEqual(a->right, b->right);
+}
+
+/*
+    ---------------- helper functions ----------------
+*/
+/*
+    ---------------- Other operations ----------------
+*/
+int treeToArr(TreeNode root, uint32_t arr[], int i) {
+
+    if (root == NULL) return i;
+    if (root->left != NULL) i = treeToArr(root->left, arr, i);
+    arr[i] = root->data;
+    i++;
+    if (root->right != NULL) i = treeToArr(root->right, arr, i);
+    return i;
+}
+
+// this func checks if a num exists in an array
+bool binarySearch(uint32 *n, uint32 low, uint32 high, uint32 target) {
+    if (high >= low) {
+		uint32 mid = low + (high - low) / 2;
+		if (n[mid] == target) return true;
+		if (n[mid] > target) return binarySearch(n, low, mid - 1, target);
+		return binarySearch(n, mid + 1, high, target);
+	}
+	return false;
+}
+
+// checks if 2 sorted arrays have an element in common
+bool numsOverlap(uint32 *a, uint32 asize, uint32 *b, uint32 bsize) {
+	uint32 i = 0, j = 0;
+	if (asize == 0 || bsize == 0) return false;
+	// sets whose spans don't meet can't share anything
+	if (a[asize - 1] < b[0] || b[bsize - 1] < a[0]) return false;
+	if (asize > bsize * GALLOP_RATIO || bsize > asize * GALLOP_RATIO) {
+		// look every element of the smaller set up in the larger one,
+		// galloping forward from where the last search ended
+		uint32 *small = (asize < bsize) ? a : b, *large = (asize < bsize) ? b : a;
+		uint32 ssize = Min(asize, bsize), lsize = Max(asize, bsize);
+		for (i = 0; i < ssize && j < lsize; i++) {
+			j = gallopBound(large, j, lsize, small[i]);
+			if (j < lsize && large[j] == small[i]) return true;
+		}
+		return false;
+	}
+	while (i < asize && j < bsize) {
+		if (a[i] < b[j]) i++;
+		else if (a[i] > b[j]) j++;
+		else return true;
+	}
+	return false;
+}
+
+// checks if sorted array a contains every element of sorted array b
+bool numsContain(uint32 *a, uint32 asize, uint32 *b, uint32 bsize) {
+	uint32 i = 0, j = 0;
+	if (asize < bsize) return false;
+	while (i < asize && j < bsize) {
+		if (a[i] < b[j]) i++;
+		else if (a[i] > b[j]) return false;
+		else {
+			i++;
+			j++;
+		}
+	}
+	return j == bsize;
+}
+
+// counts the elements 2 sorted arrays have in common
+uint32 numsIntersectSize(uint32 *a, uint32 asize, uint32 *b, uint32 bsize) {
+	uint32 i = 0, j = 0, len = 0;
+	while (i < asize && j < bsize) {
+		if (a[i] < b[j]) i++;
+		else if (a[i] > b[j]) j++;
+		else {
+			len++;
+			i++;
+			j++;
+		}
+	}
+	return len;
+}
+
+// the Jaccard distance of 2 sorted arrays, 1 - |a && b| / |a || b|
+double jaccardDistance(uint32 *a, uint32 asize, uint32 *b, uint32 bsize) {
+	uint32 common;
+	if (asize == 0 && bsize == 0) return 0.0;
+	common = numsIntersectSize(a, asize, b, bsize);
+	return 1.0 - (double) common / (double) (asize + bsize - common);
+}
+
+// given 2 sorted arrays of the same size, check if they r equal
+bool numsEqual(uint32 *a, uint32 *b, uint32 size) {
+	for (uint32_t i = 0; i < size; i++) {
+		if (a[i] != b[i]) return false;
+	}
+	return true;
+}
+
+// returns the index of the first element in a sorted array that is >= target
+// (or size if there is none)
+uint32 lowerBound(uint32 *n, uint32 size, uint32 target) {
+	uint32 low = 0, high = size;
+	while (low < high) {
+		uint32 mid = low + (high - low) / 2;
+		if (n[mid] < target) low = mid + 1;
+		else high = mid;
+	}
+	return low;
+}
+
+// the same as lowerBound(), but only searches from index from on: it doubles
+// the step until it passes target and then does a binary search in the last
+// step, so finding the next element is cheap when it is close to from
+uint32 gallopBound(uint32 *n, uint32 from, uint32 size, uint32 target) {
+	uint32 low = from, high, step = 1;
+	if (from >= size || n[from] >= target) return from;
+	// n[low] < target from here on
+	while (low + step < size && n[low + step] < target) {
+		low += step;
+		step *= 2;
+	}
+	high = Min(low + step, size);
+	return low + 1 + lowerBound(n + low + 1, high - low - 1, target);
+}
+
+// returns the index of the first element in a sorted array that is > target
+// (or size if there is none)
+uint32 upperBound(uint32 *n, uint32 size, uint32 target) {
+	uint32 low = 0, high = size;
+	while (low < high) {
+		uint32 mid = low + (high - low) / 2;
+		if (n[mid] <= target) low = mid + 1;
+		else high = mid;
+	}
+	return low;
+}
+
+// makes a new intset holding a copy of the given sorted array
+intSet *newIntSet(uint32 *nums, uint32 size) {
+	intSet *result = (intSet *) palloc(VARHDRSZ + size * 4);
+	SET_VARSIZE(result, VARHDRSZ + size * 4);
+	if (size > 0) memcpy(VARDATA_ANY(result), nums, size * 4);
+	return result;
+}
+
+// turns an int4[] into a sorted array of distinct elements, each integer is
+// the element ? matches it with (a negative one is over PG_INT32_MAX)
+uint32 *arrayToNums(ArrayType *arr, uint32 *size) {
+	int32 *data;
+	uint32 *res;
+	int n, len = 0;
+
+	if (ARR_ELEMTYPE(arr) != INT4OID)
+		ereport(ERROR,
+			(errcode(ERRCODE_DATATYPE_MISMATCH),
+			errmsg("array must be of type integer[]")));
+	if (array_contains_nulls(arr))
+		ereport(ERROR,
+			(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			errmsg("array must not contain nulls")));
+
+	// an int4 array without nulls is just a plain C array of int32
+	n = ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr));
+	data = (int32 *) ARR_DATA_PTR(arr);
+	res = (uint32 *) palloc(Max(n, 1) * 4);
+	for (int i = 0; i < n; i++) res[len++] = (uint32) data[i];
+
+	radixSort(res, len);
+	*size = uniqueNums(res, len);
+	return res;
+}
+
+// sorts an array of uint32 in place, one byte at a time from the lowest one
+// (a byte that is the same in every element doesn't need a pass)
+void radixSort(uint32 *arr, uint32 size) {
+	uint32 *buf, *src = arr, *dst, *tmp;
+	uint32 count[256];
+
+	if (size < 2) return;
+	buf = (uint32 *) palloc(size * 4);
+	dst = buf;
+	for (int shift = 0; shift < 32; shift += 8) {
+		uint32 pos = 0;
+
+		memset(count, 0, sizeof(count));
+		for (uint32 i = 0; i < size; i++) count[(src[i] >> shift) & 0xFF]++;
+		if (count[(src[0] >> shift) & 0xFF] == size) continue;
+
+		// turn the counts into the starting position of each bucket
+		for (int d = 0; d < 256; d++) {
+			uint32 c = count[d];
+			count[d] = pos;
+			pos += c;
+		}
+		for (uint32 i = 0; i < size; i++) dst[count[(src[i] >> shift) & 0xFF]++] = src[i];
+		tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+	// the sorted elements may have ended up in the buffer
+	if (src != arr) memcpy(arr, src, size * 4);
+	pfree(buf);
+}
+
+// removes the duplicates from a sorted array in place and returns the new size
+uint32 uniqueNums(uint32 *arr, uint32 size) {
+	uint32 len = 0;
+	for (uint32 i = 0; i < size; i++) {
+		if (len == 0 || arr[len - 1] != arr[i]) arr[len++] = arr[i];
+	}
+	return len;
+}
+
+// merges 2 sorted arrays into out (which has room for both) without duplicates
+// and returns the number of elements written
+uint32 mergeUnion(uint32 *a, uint32 asize, uint32 *b, uint32 bsize, uint32 *out) {
+	uint32 i = 0, j = 0, len = 0;
+	while (i < asize && j < bsize) {
+		if (a[i] < b[j]) out[len++] = a[i++];
+		else if (a[i] > b[j]) out[len++] = b[j++];
+		else {
+			out[len++] = a[i++];
+			j++;
+		}
+	}
+	while (i < asize) out[len++] = a[i++];
+	while (j < bsize) out[len++] = b[j++];
+	return len;
+}
+
+// writes the elements of sorted array a that are not in sorted array b into out
+// and returns the number of elements written
+uint32 mergeDiff(uint32 *a, uint32 asize, uint32 *b, uint32 bsize, uint32 *out) {
+	uint32 i = 0, j = 0, len = 0;
+	while (i < asize && j < bsize) {
+		if (a[i] < b[j]) out[len++] = a[i++];
+		else if (a[i] > b[j]) j++;
+		else {
+			i++;
+			j++;
+		}
+	}
+	while (i < asize) out[len++] = a[i++];
+	return len;
+}
+
+// writes the elements of sorted array a that are also in sorted array b into
+// out (which may be a itself) and returns the number of elements written
+uint32 mergeIntersect(uint32 *a, uint32 asize, uint32 *b, uint32 bsize, uint32 *out) {
+	uint32 i = 0, j = 0, len = 0;
+	while (i < asize && j < bsize) {
+		if (a[i] < b[j]) i++;
+		else if (a[i] > b[j]) j++;
+		else {
+			out[len++] = a[i++];
+			j++;
+		}
+	}
+	return len;
+}
+
+// the detoasted sets of an intset[], NULL if any of them is NULL
+intSet **arrayToSets(ArrayType *arr, int *n) {
+	Datum *elems;
+	bool *nulls;
+	int16 typlen;
+	bool typbyval;
+	char typalign;
+	intSet **sets;
+
+	get_typlenbyvalalign(ARR_ELEMTYPE(arr), &typlen, &typbyval, &typalign);
+	deconstruct_array(arr, ARR_ELEMTYPE(arr), typlen, typbyval, typalign, &elems, &nulls, n);
+	sets = (intSet **) palloc(Max(*n, 1) * sizeof(intSet *));
+	for (int i = 0; i < *n; i++) {
+		if (nulls[i]) return NULL;
+		// the elements of an array may have short headers, so they are copied
+		// out to get at their numbers aligned
+		sets[i] = DatumGetIntSetP(elems[i]);
+	}
+	return sets;
+}
+
+// the union of n sets: all of their elements sorted at once
+intSet *setsUnion(intSet **sets, int n) {
+	uint64 total = 0;
+	uint32 len = 0, size;
+	uint32 *nums;
+	intSet *result;
+
+	for (int i = 0; i < n; i++) total += VARSIZE_ANY_EXHDR(sets[i]) / 4;
+	result = allocIntSet(total);
+	nums = (uint32 *) VARDATA(result);
+	for (int i = 0; i < n; i++) {
+		size = VARSIZE_ANY_EXHDR(sets[i]) / 4;
+		if (size > 0) memcpy(nums + len, VARDATA_ANY(sets[i]), size * 4);
+		len += size;
+	}
+	radixSort(nums, len);
+	SET_VARSIZE(result, VARHDRSZ + uniqueNums(nums, len) * 4);
+	return result;
+}
+
+// the intersection of n > 0 sets: the smallest one, less what any other
+// one doesn't have
+intSet *setsIntersect(intSet **sets, int n) {
+	int smallest = 0;
+	uint32 len;
+	uint32 *nums;
+	intSet *result;
+
+	for (int i = 1; i < n; i++) {
+		if (VARSIZE_ANY_EXHDR(sets[i]) < VARSIZE_ANY_EXHDR(sets[smallest])) smallest = i;
+	}
+	len = VARSIZE_ANY_EXHDR(sets[smallest]) / 4;
+	result = newIntSet((uint32 *) VARDATA_ANY(sets[smallest]), len);
+	nums = (uint32 *) VARDATA(result);
+	for (int i = 0; i < n && len > 0; i++) {
+		if (i == smallest) continue;
+		len = mergeIntersect(nums, len, (uint32 *) VARDATA_ANY(sets[i]),
+							 VARSIZE_ANY_EXHDR(sets[i]) / 4, nums);
+	}
+	SET_VARSIZE(result, VARHDRSZ + len * 4);
+	return result;
+}
+
+// allocates an intset for the given number of elements
+// (complaining if that many elements can't be stored)
+intSet *allocIntSet(uint64 size) {
+	intSet *result;
+	if (!AllocSizeIsValid(VARHDRSZ + size * 4))
+		ereport(ERROR,
+			(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+			errmsg("intset cannot hold more than %u elements",
+					(uint32) ((MaxAllocSize - VARHDRSZ) / 4))));
+	result = (intSet *) palloc(VARHDRSZ + size * 4);
+	SET_VARSIZE(result, VARHDRSZ + size * 4);
+	return result;
+}
+
+// adds every element in [lo, hi] (lo <= hi) to a set, returns a itself if
+// they are all in it already
+intSet *setAddRange(intSet *a, uint32 lo, uint32 hi) {
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, start, end;
+	uint64 len = (uint64) hi - lo + 1;
+	intSet *result;
+	uint32 *res_nums;
+
+	// nums[start .. end - 1] are the elements of A already in the range
+	start = lowerBound(anums, asize, lo);
+	end = upperBound(anums, asize, hi);
+	if (end - start == len) return a;
+
+	// keep the elements on both sides and write the whole range in between
+	result = allocIntSet(start + len + (asize - end));
+	res_nums = (uint32 *) VARDATA_ANY(result);
+	memcpy(res_nums, anums, start * 4);
+	for (uint32 i = 0; i < len; i++) res_nums[start + i] = lo + i;
+	memcpy(res_nums + start + len, anums + end, (asize - end) * 4);
+	return result;
+}
+
+// removes every element in [lo, hi] (lo <= hi) from a set, returns a itself
+// if none of them is in it
+intSet *setRemoveRange(intSet *a, uint32 lo, uint32 hi) {
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, start, end;
+	intSet *result;
+	uint32 *res_nums;
+
+	start = lowerBound(anums, asize, lo);
+	end = upperBound(anums, asize, hi);
+	if (start == end) return a;
+
+	// move the elements after the range next to the ones before it
+	result = allocIntSet(asize - (end - start));
+	res_nums = (uint32 *) VARDATA_ANY(result);
+	memcpy(res_nums, anums, start * 4);
+	memcpy(res_nums + start, anums + end, (asize - end) * 4);
+	return result;
+}
+
+// toggles every element in [lo, hi] (lo <= hi) of a set
+intSet *setFlipRange(intSet *a, uint32 lo, uint32 hi) {
+	uint32 *anums = (uint32 *) VARDATA_ANY(a);
+	uint32 asize = VARSIZE_ANY_EXHDR(a) / 4, start, end, pos;
+	uint64 len = (uint64) hi - lo + 1, next;
+	intSet *result;
+	uint32 *res_nums;
+
+	start = lowerBound(anums, asize, lo);
+	end = upperBound(anums, asize, hi);
+
+	// the range loses the end - start elements it had and gains the rest
+	result = allocIntSet(start + (len - (end - start)) + (asize - end));
+	res_nums = (uint32 *) VARDATA_ANY(result);
+	memcpy(res_nums, anums, start * 4);
+	pos = start;
+	// next is 64 bits wide so that hi can be PG_UINT32_MAX
+	next = lo;
+	// fill in the gaps between the elements of A inside the range
+	for (uint32 i = start; i < end; i++) {
+		while (next < anums[i]) res_nums[pos++] = (uint32) next++;
+		next = (uint64) anums[i] + 1;
+	}
+	while (next <= hi) res_nums[pos++] = (uint32) next++;
+	memcpy(res_nums + pos, anums + end, (asize - end) * 4);
+	return result;
+}
+
+// compares 2 sorted arrays lexicographically, a prefix is less than the whole
+int numsCompare(uint32 *a, uint32 asize, uint32 *b, uint32 bsize) {
+	uint32 size = Min(asize, bsize);
+	for (uint32_t i = 0; i < size; i++) {
+		if (a[i] != b[i]) return (a[i] < b[i]) ? -1 : 1;
+	}
+	if (asize == bsize) return 0;
+	return (asize < bsize) ? -1 : 1;
+}
+
+/*
+    ---------------- GIN key operations ----------------
+*/
+// turns sorted nums[] into the GIN keys nums[i] >> shift, since nums[] is
+// sorted only neighbours can fall into the same bucket
+Datum *ginNumsKeys(uint32 *nums, uint32 size, int shift, int32 *nentries) {
+	Datum *entries = NULL;
+	uint32 n = 0;
+
+	if (size > 0) {
+		entries = (Datum *) palloc(size * sizeof(Datum));
+		entries[n++] = UInt32GetDatum(nums[0] >> shift);
+		for (uint32 i = 1; i < size; i++) {
+			if ((nums[i] >> shift) != (nums[i - 1] >> shift))
+				entries[n++] = UInt32GetDatum(nums[i] >> shift);
+		}
+	}
+	*nentries = n;
+	return entries;
+}
+
+// the extractQuery of both GIN opclasses, shift is 0 for intset_gin_ops
+Datum *ginQueryKeys(FunctionCallInfo fcinfo, int shift) {
+	int32 *nentries = (int32 *) PG_GETARG_POINTER(1);
+	StrategyNumber strategy = PG_GETARG_UINT16(2);
+	int32 *searchMode = (int32 *) PG_GETARG_POINTER(6);
+	Datum *entries = NULL;
+	intSet *q;
+	uint32 qsize;
+
+	*nentries = 0;
+	if (strategy == INTSET_OVERLAP_RANGE_STRATEGY) {
+		// one partial match key: scan the keys from lo on until one passes hi
+		bool **pmatch = (bool **) PG_GETARG_POINTER(3);
+		Pointer **extra_data = (Pointer **) PG_GETARG_POINTER(4);
+		uint32 lo, hi;
+		if (rangeToBounds(PG_GETARG_RANGE_P(0), &lo, &hi)) {
+			entries = (Datum *) palloc(sizeof(Datum));
+			entries[0] = UInt32GetDatum(lo >> shift);
+			*pmatch = (bool *) palloc(sizeof(bool));
+			(*pmatch)[0] = true;
+			*extra_data = (Pointer *) palloc(sizeof(Pointer));
+			(*extra_data)[0] = (Pointer) palloc(sizeof(uint32));
+			*((uint32 *) (*extra_data)[0]) = hi >> shift;
+			*nentries = 1;
+		}
+		return entries;
+	}
+	if (strategy == INTSET_HAS_STRATEGY) {
+		// the integer is read as unsigned, the way the operator reads it
+		entries = (Datum *) palloc(sizeof(Datum));
+		entries[0] = UInt32GetDatum(PG_GETARG_UINT32(0) >> shift);
+		*nentries = 1;
+		return entries;
+	}
+
+	q = PG_GETARG_INTSET_P(0);
+	qsize = VARSIZE_ANY_EXHDR(q) / 4;
+	entries = ginNumsKeys((uint32 *) VARDATA_ANY(q), qsize, shift, nentries);
+
+	switch (strategy) {
+		case INTSET_OVERLAP_STRATEGY:
+			// nothing overlaps an empty set, so no keys means no matches
+			break;
+		case INTSET_CONTAINS_STRATEGY:
+			// every set contains the empty set
+			if (qsize == 0) *searchMode = GIN_SEARCH_MODE_ALL;
+			break;
+		case INTSET_CONTAINED_STRATEGY:
+			// the empty set is contained in every set, so it must be found too
+			*searchMode = GIN_SEARCH_MODE_INCLUDE_EMPTY;
+			break;
+		default:
+			elog(ERROR, "unrecognized strategy number: %d", strategy);
+	}
+	return entries;
+}
+
+// the consistent check of a row that has the keys marked in check[]
+bool ginConsistent(bool *check, StrategyNumber strategy, int32 nkeys, bool *recheck) {
+	bool res = true;
+
+	*recheck = false;
+	switch (strategy) {
+		case INTSET_OVERLAP_STRATEGY:
+		case INTSET_HAS_STRATEGY:
+		case INTSET_OVERLAP_RANGE_STRATEGY:
+			// the row has one of the keys, that is all we need
+			res = false;
+			for (int32 i = 0; i < nkeys && !res; i++) res = check[i];
+			break;
+		case INTSET_CONTAINS_STRATEGY:
+			// the row must have all the keys
+			for (int32 i = 0; i < nkeys && res; i++) res = check[i];
+			break;
+		case INTSET_CONTAINED_STRATEGY:
+			// the index can't tell whether the row has other elements too
+			*recheck = true;
+			break;
+		default:
+			elog(ERROR, "unrecognized strategy number: %d", strategy);
+	}
+	return res;
+}
+
+// the same as ginConsistent() when some keys may or may not be there
+GinTernaryValue ginTriConsistent(GinTernaryValue *check, StrategyNumber strategy, int32 nkeys) {
+	GinTernaryValue res = GIN_MAYBE;
+
+	switch (strategy) {
+		case INTSET_OVERLAP_STRATEGY:
+		case INTSET_HAS_STRATEGY:
+		case INTSET_OVERLAP_RANGE_STRATEGY:
+			// true as soon as one key is surely there
+			res = GIN_FALSE;
+			for (int32 i = 0; i < nkeys; i++) {
+				if (check[i] == GIN_TRUE) {
+					res = GIN_TRUE;
+					break;
+				}
+				if (check[i] == GIN_MAYBE) res = GIN_MAYBE;
+			}
+			break;
+		case INTSET_CONTAINS_STRATEGY:
+			// false as soon as one key is surely missing
+			res = GIN_TRUE;
+			for (int32 i = 0; i < nkeys; i++) {
+				if (check[i] == GIN_FALSE) {
+					res = GIN_FALSE;
+					break;
+				}
+				if (check[i] == GIN_MAYBE) res = GIN_MAYBE;
+			}
+			break;
+		case INTSET_CONTAINED_STRATEGY:
+			// always needs a recheck
+			res = GIN_MAYBE;
+			break;
+		default:
+			elog(ERROR, "unrecognized strategy number: %d", strategy);
+	}
+	return res;
+}
+
+/*
+    ---------------- Bloom filter operations ----------------
+*/
+// the i-th bit of an element is h1 + i * h2, from one 64-bit hash of it
+#define BLOOM_BIT(h, i)	(((uint32) (h) + (i) * ((uint32) ((h) >> 32) | 1)) % (BLOOM_BYTES * 8))
+
+// adds an element to a bloom filter of BLOOM_BYTES bytes
+// and returns true if that set any new bit
+bool bloomAdd(char *bloom, uint32 n) {
+	uint64 h = DatumGetUInt64(hash_uint32_extended(n, 0));
+	bool changed = false;
+	for (uint32 i = 0; i < BLOOM_HASHES; i++) {
+		uint32 bit = BLOOM_BIT(h, i);
+		if (!(bloom[bit / 8] & (1 << (bit % 8)))) changed = true;
+		bloom[bit / 8] |= 1 << (bit % 8);
+	}
+	return changed;
+}
+
+// checks if an element may have been added to a bloom filter
+bool bloomMayContain(char *bloom, uint32 n) {
+	uint64 h = DatumGetUInt64(hash_uint32_extended(n, 0));
+	for (uint32 i = 0; i < BLOOM_HASHES; i++) {
+		uint32 bit = BLOOM_BIT(h, i);
+		if (!(bloom[bit / 8] & (1 << (bit % 8)))) return false;
+	}
+	return true;
+}
+
+/*
+    ---------------- Signature operations ----------------
+*/
+// a signature of NULL stands for one with every bit set
+
+// sets the bit of every element in a signature
+void signAddNums(char *sign, int siglen, uint32 *nums, uint32 size) {
+	uint32 bits = siglen * 8;
+	for (uint32 i = 0; i < size; i++) {
+		uint32 h = nums[i] % bits;
+		sign[h / 8] |= 1 << (h % 8);
+	}
+}
+
+// returns the signature of a key
+// (for an exact key it is made up in a new palloc'd buffer)
+char *keySign(intSetGistKey *key, int siglen) {
+	char *sign;
+	if (key->flag & GKEY_ALLTRUE) return NULL;
+	if (key->flag & GKEY_SIGN) return key->data;
+	sign = (char *) palloc0(siglen);
+	signAddNums(sign, siglen, (uint32 *) key->data, (VARSIZE(key) - GKEY_HDRSZ) / 4);
+	return sign;
+}
+
+// makes a leaf key that holds the set itself
+intSetGistKey *makeExactKey(uint32 *nums, uint32 size) {
+	intSetGistKey *key = (intSetGistKey *) palloc(GKEY_HDRSZ + size * 4);
+	SET_VARSIZE(key, GKEY_HDRSZ + size * 4);
+	key->flag = GKEY_EXACT;
+	key->mincard = size;
+	key->maxcard = size;
+	if (size > 0) memcpy(key->data, nums, size * 4);
+	return key;
+}
+
+// makes a key out of a signature and the range of the set sizes under it
+// (one with every bit set needs no data)
+intSetGistKey *makeSignKey(char *sign, int siglen, uint32 mincard, uint32 maxcard) {
+	intSetGistKey *key;
+	if (sign == NULL || hemdistSign(NULL, sign, siglen) == 0) {
+		key = (intSetGistKey *) palloc(GKEY_HDRSZ);
+		SET_VARSIZE(key, GKEY_HDRSZ);
+		key->flag = GKEY_ALLTRUE;
+	} else {
+		key = (intSetGistKey *) palloc(GKEY_HDRSZ + siglen);
+		SET_VARSIZE(key, GKEY_HDRSZ + siglen);
+		key->flag = GKEY_SIGN;
+		memcpy(key->data, sign, siglen);
+	}
+	key->mincard = mincard;
+	key->maxcard = maxcard;
+	return key;
+}
+
+// counts the bits that differ between 2 signatures, 8 bytes at a time
+int hemdistSign(char *a, char *b, int siglen) {
+	int dist = 0, i = 0;
+	uint64 x, y;
+
+	if (a == NULL && b == NULL) return 0;
+	if (a == NULL || b == NULL) {
+		// the distance to all ones is the number of zero bits
+		return siglen * 8 - (int) pg_popcount(a == NULL ? b : a, siglen);
+	}
+	for (; i + 8 <= siglen; i += 8) {
+		memcpy(&x, a + i, 8);
+		memcpy(&y, b + i, 8);
+		dist += pg_popcount64(x ^ y);
+	}
+	for (; i < siglen; i++) dist += pg_number_of_ones[(unsigned char) (a[i] ^ b[i])];
+	return dist;
+}
+
+// ORs the signature src into dst
+void signUnion(char *dst, char *src, int siglen) {
+	if (src == NULL) {
+		memset(dst, 0xFF, siglen);
+		return;
+	}
+	for (int i = 0; i < siglen; i++) dst[i] |= src[i];
+}
+
+// turns an int4range into the inclusive bounds [lo, hi] of the elements it
+// can hold, returns false if it can't hold any
+bool rangeToBounds(RangeType *r, uint32 *lo, uint32 *hi) {
+	TypeCacheEntry *typcache = lookup_type_cache(RangeTypeGetOid(r), TYPECACHE_RANGE_INFO);
+	RangeBound lower, upper;
+	bool empty;
+	int64 lv;
+	int32 v;
+
+	range_deserialize(typcache, r, &lower, &upper, &empty);
+	if (empty) return false;
+
+	*lo = 0;
+	if (!lower.infinite) {
+		// int64 so that an exclusive INT_MAX still moves past it
+		lv = (int64) DatumGetInt32(lower.val) + (lower.inclusive ? 0 : 1);
+		if (lv > 0) *lo = (uint32) lv;
+	}
+
+	*hi = PG_UINT32_MAX;
+	if (!upper.infinite) {
+		v = DatumGetInt32(upper.val);
+		if (!upper.inclusive) {
+			if (v == PG_INT32_MIN) return false;
+			v--;
+		}
+		if (v < 0) return false;
+		*hi = (uint32) v;
+	}
+	return *lo <= *hi;
+}
+
+// the span [min, max] of sorted nums[], the empty set has min > max
+void numsSpan(uint32 *nums, uint32 size, float8 *min, float8 *max) {
+	if (size == 0) {
+		*min = get_float8_infinity();
+		*max = -get_float8_infinity();
+		return;
+	}
+	*min = (float8) nums[0];
+	*max = (float8) nums[size - 1];
+}
+
+// the span [lo, hi] of sorted nums[] as the integers ? matches them with: an
+// element over PG_INT32_MAX is the negative integer with the same bits, so
+// the elements from there on come first; false for the empty set
+bool numsIntSpan(uint32 *nums, uint32 size, int32 *lo, int32 *hi) {
+	uint32 wrap = intWrap(nums, size);
+
+	if (size == 0) return false;
+	*lo = (int32) nums[(wrap < size) ? wrap : 0];
+	*hi = (int32) nums[(wrap > 0) ? wrap - 1 : size - 1];
+	return true;
+}
+
+// the index of the first element of sorted nums[] over PG_INT32_MAX (size if
+// there is none): as integers nums[wrap ..] come first, then nums[0 .. wrap - 1]
+// so position p in the integer order is nums[wrap + p] for p < size - wrap and
+// nums[p - (size - wrap)] after that
+uint32 intWrap(uint32 *nums, uint32 size) {
+	return lowerBound(nums, size, (uint32) PG_INT32_MAX + 1);
+}
+
+// the position (in the integer order, see intWrap) of the first element of
+// sorted nums[] that is >= x as an integer (or size if there is none)
+uint32 intLowerBound(uint32 *nums, uint32 size, int32 x) {
+	uint32 wrap = intWrap(nums, size);
+
+	if (x < 0) return lowerBound(nums + wrap, size - wrap, (uint32) x);
+	return (size - wrap) + lowerBound(nums, wrap, (uint32) x);
+}
+
+// the position (in the integer order, see intWrap) of the first element of
+// sorted nums[] that is > x as an integer (or size if there is none)
+uint32 intUpperBound(uint32 *nums, uint32 size, int32 x) {
+	uint32 wrap = intWrap(nums, size);
+
+	if (x < 0) return upperBound(nums + wrap, size - wrap, (uint32) x);
+	return (size - wrap) + upperBound(nums, wrap, (uint32) x);
+}
+
+// a new intset holding the elements of sorted nums[] at the positions
+// [from, to) of the integer order (see intWrap), the ones not over
+// PG_INT32_MAX are the smaller elements so they go first
+intSet *intSlice(uint32 *nums, uint32 size, uint32 from, uint32 to) {
+	uint32 wrap = intWrap(nums, size), neg = size - wrap;
+	uint32 lofrom = Max(from, neg) - neg, loto = Max(to, neg) - neg;
+	uint32 hifrom = wrap + Min(from, neg), hito = wrap + Min(to, neg);
+	intSet *result = allocIntSet((uint64) (loto - lofrom) + (hito - hifrom));
+	uint32 *res_nums = (uint32 *) VARDATA_ANY(result);
+
+	if (loto > lofrom) memcpy(res_nums, nums + lofrom, (loto - lofrom) * 4);
+	if (hito > hifrom) memcpy(res_nums + (loto - lofrom), nums + hifrom, (hito - hifrom) * 4);
+	return result;
+}
+
+// element i of a set, fetched without detoasting the rest of it
+uint32 sliceElement(Datum d, uint32 i) {
+	intSet *a = (intSet *) PG_DETOAST_DATUM_SLICE(d, i * 4, 4);
+	uint32 n = ((uint32 *) VARDATA_ANY(a))[0];
+
+	pfree(a);
+	return n;
+}
+
+// the bounds [lo, hi] a span is checked against for an int4range query,
+// returns false if no span can match it at all
+bool spanQuery(RangeType *r, StrategyNumber strategy, float8 *lo, float8 *hi) {
+	uint32 l, h;
+
+	if (rangeToBounds(r, &l, &h)) {
+		*lo = (float8) l;
+		*hi = (float8) h;
+		return true;
+	}
+	// only the empty set is within a range that can't hold any element
+	if (strategy != INTSET_SPAN_WITHIN_STRATEGY) return false;
+	*lo = get_float8_infinity();
+	*hi = -get_float8_infinity();
+	return true;
+}
+
+// checks the span [min, max] of a set against the bounds from spanQuery()
+bool spanConsistent(float8 min, float8 max, float8 lo, float8 hi, StrategyNumber strategy) {
+	if (strategy == INTSET_SPAN_WITHIN_STRATEGY) return min >= lo && max <= hi;
+	return min <= hi && max >= lo;
+}
+
+/*
+    ---------------- Selectivity operations ----------------
+*/
+// the body of the restriction estimators, negate is for <>
+float8 restrictSel(FunctionCallInfo fcinfo, StrategyNumber strategy, bool negate) {
+	PlannerInfo *root = (PlannerInfo *) PG_GETARG_POINTER(0);
+	Oid operator = PG_GETARG_OID(1);
+	List *args = (List *) PG_GETARG_POINTER(2);
+	int varRelid = PG_GETARG_INT32(3);
+	VariableStatData vardata;
+	Node *other;
+	bool varonleft, isdefault;
+	Const *c;
+	intSet *q;
+	intSetStats stats;
+	float8 sel, eq;
+	uint32 single;
+
+	// only var OP const (or const OP var) can be estimated
+	if (!get_restriction_variable(root, args, varRelid, &vardata, &other, &varonleft))
+		return negate ? 1.0 - DEFAULT_EQ_SEL : DEFAULT_CONTAIN_SEL;
+	if (!IsA(other, Const)) {
+		sel = negate ? 1.0 - DEFAULT_EQ_SEL : DEFAULT_CONTAIN_SEL;
+		if (strategy == INTSET_HAS_STRATEGY && vardata.vartype == INT4OID)
+			sel /= boundsSel(root, &vardata, other, get_func_namespace(get_opcode(operator)), varRelid);
+		ReleaseVariableStats(vardata);
+		CLAMP_PROBABILITY(sel);
+		return sel;
+	}
+	c = (Const *) other;
+	// the operators are strict, so nothing matches null
+	if (c->constisnull) {
+		ReleaseVariableStats(vardata);
+		return 0.0;
+	}
+
+	loadStats(&vardata, &stats);
+
+	if (strategy == INTSET_HAS_STRATEGY && c->consttype == INT4OID) {
+		// set column ? element: the rows that have that element (read as
+		// unsigned, the way the operator reads it)
+		single = DatumGetUInt32(c->constvalue);
+		sel = numsSel(&stats, &single, 1, INTSET_CONTAINS_STRATEGY);
+	} else if (strategy == INTSET_HAS_STRATEGY) {
+		// integer column ? set: the rows whose value is one of the elements
+		q = DatumGetIntSetP(c->constvalue);
+		sel = (float8) (VARSIZE_ANY_EXHDR(q) / 4) / get_variable_numdistinct(&vardata, &isdefault);
+		sel *= 1.0 - stats.nullfrac;
+		sel /= boundsSel(root, &vardata, other, get_func_namespace(get_opcode(operator)), varRelid);
+	} else {
+		q = DatumGetIntSetP(c->constvalue);
+		// const >@ column is column @< const, and the other way round
+		if (!varonleft && strategy == INTSET_CONTAINS_STRATEGY) strategy = INTSET_CONTAINED_STRATEGY;
+		else if (!varonleft && strategy == INTSET_CONTAINED_STRATEGY) strategy = INTSET_CONTAINS_STRATEGY;
+		sel = numsSel(&stats, (uint32 *) VARDATA_ANY(q), VARSIZE_ANY_EXHDR(q) / 4, strategy);
+		if (strategy == INTSET_EQUAL_STRATEGY) {
+			// the most common values of the column know better, but a set
+			// can't be more common than the sets of its size; for <> it is
+			// its negator = that eqsel has to match them with
+			if (negate) operator = get_negator(operator);
+			if (OidIsValid(operator)) {
+				eq = DatumGetFloat8(DirectFunctionCall4(eqsel, PG_GETARG_DATUM(0), ObjectIdGetDatum(operator),
+														PG_GETARG_DATUM(2), PG_GETARG_DATUM(3)));
+				sel = Min(sel, eq);
+			}
+			if (negate) sel = 1.0 - stats.nullfrac - sel;
+		}
+	}
+
+	freeStats(&stats);
+	ReleaseVariableStats(vardata);
+	CLAMP_PROBABILITY(sel);
+	return sel;
+}
+
+// the selectivity of the bounds pruneBounds gives the column of vardata and
+// set if the clauses of its rel have both of them, 1.0 otherwise: they were
+// added for the partition pruner next to ? (see pruneMembership) and hold for
+// every row ? keeps, so ? is divided by this not to count them twice
+float8 boundsSel(PlannerInfo *root, VariableStatData *vardata, Node *set, Oid nsp, int varRelid) {
+	List *bounds;
+	ListCell *lb, *lc;
+	bool found;
+
+	if (vardata->rel == NULL || vardata->var == NULL || !IsA(vardata->var, Var)) return 1.0;
+	if (list_length(vardata->rel->baserestrictinfo) < 3) return 1.0;
+	bounds = pruneBounds((Var *) vardata->var, set, nsp);
+	if (bounds == NIL) return 1.0;
+	foreach(lb, bounds) {
+		found = false;
+		foreach(lc, vardata->rel->baserestrictinfo) {
+			if (equal(((RestrictInfo *) lfirst(lc))->clause, lfirst(lb))) {
+				found = true;
+				break;
+			}
+		}
+		if (!found) return 1.0;
+	}
+	return Max(clauselist_selectivity(root, bounds, varRelid, JOIN_INNER, NULL), 1.0e-10);
+}
+
+// fills stats from the statistics of the column, the slots that are missing
+// are left out
+void loadStats(VariableStatData *vardata, intSetStats *stats) {
+	float8 mcesum = 0.0;
+
+	memset(stats, 0, sizeof(intSetStats));
+	if (!HeapTupleIsValid(vardata->statsTuple)) return;
+
+	stats->nullfrac = ((Form_pg_statistic) GETSTRUCT(vardata->statsTuple))->stanullfrac;
+	// min, max and null frequencies come after the element frequencies
+	if (get_attstatsslot(&stats->mcelem, vardata->statsTuple, STATISTIC_KIND_MCELEM, InvalidOid,
+						 ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS)) {
+		if (stats->mcelem.nnumbers == stats->mcelem.nvalues + 3) {
+			stats->hasMcelem = true;
+			stats->nmce = stats->mcelem.nvalues;
+			stats->minfreq = stats->mcelem.numbers[stats->nmce];
 		} else {
-			root->left = left_rotate(root->left);
-			root = right_rotate(root);
+			free_attstatsslot(&stats->mcelem);
 		}
-	} else if (balanced < -1) {
-		if (n > root->right->data) {
-			root = left_rotate(root);
+	}
+	// the average and the number of distinct elements come after the histogram
+	if (get_attstatsslot(&stats->dechist, vardata->statsTuple, STATISTIC_KIND_DECHIST, InvalidOid,
+						 ATTSTATSSLOT_NUMBERS)) {
+		if (stats->dechist.nnumbers >= 3) {
+			stats->hasDechist = true;
+			stats->nhist = stats->dechist.nnumbers - 2;
+			stats->avgcount = stats->dechist.numbers[stats->nhist];
+			stats->ndistinct = stats->dechist.numbers[stats->nhist + 1];
 		} else {
-			root->right = right_rotate(root->right);
-			root = left_rotate(root);
+			free_attstatsslot(&stats->dechist);
 		}
 	}
-	return root;
+
+	// the elements that are not most common share what is left of the
+	// average set evenly, but none is more common than the rarest of them
+	stats->restfreq = Min(DEFAULT_CONTAIN_SEL, stats->minfreq / 2);
+	if (stats->hasMcelem && stats->hasDechist && stats->ndistinct > stats->nmce) {
+		for (uint32 i = 0; i < stats->nmce; i++) mcesum += stats->mcelem.numbers[i];
+		stats->restfreq = Min(stats->minfreq, Max(0.0, stats->avgcount - mcesum) /
+											  (stats->ndistinct - stats->nmce));
+	}
 }
 
+void freeStats(intSetStats *stats) {
+	if (stats->hasMcelem) free_attstatsslot(&stats->mcelem);
+	if (stats->hasDechist) free_attstatsslot(&stats->dechist);
+}
 
-// this func counts the number of nodes in a tree and return the result
-uint32_t treeSize(TreeNode root) {
-    if (root == NULL) return 0;
-    return treeSize(root->left) + treeSize(root->right) + 1;
+// the fraction of the non-null rows that have element n
+float8 elemFreq(intSetStats *stats, uint32 n) {
+	int i = mceIndex(stats, n);
+	if (i >= 0) return stats->mcelem.numbers[i];
+	return stats->restfreq;
 }
 
+// the index of element n in the most common elements, or -1
+int mceIndex(intSetStats *stats, uint32 n) {
+	uint32 low = 0, high = stats->nmce, mid;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (DatumGetUInt32(stats->mcelem.values[mid]) < n) low = mid + 1;
+		else high = mid;
+	}
+	if (low < stats->nmce && DatumGetUInt32(stats->mcelem.values[low]) == n) return (int) low;
+	return -1;
+}
 
-// this function frees up the space used by the BST
-/*
-    given: a pointer to the root of the tree we want to destroy
-*/
-void destroyTree(TreeNode root) {
-    if (root == NULL) return;
-    destroyTree(root->left);
-    destroyTree(root->right);
-    pfree(root);
+// the fraction of the non-null rows whose sets have card elements,
+// from the share of the histogram entries that are equal to it
+float8 cardFreq(intSetStats *stats, uint32 card) {
+	uint32 equal = 0;
+	for (uint32 i = 0; i < stats->nhist; i++) {
+		if ((uint32) stats->dechist.numbers[i] == card) equal++;
+	}
+	// a size the histogram missed is rarer than one entry of it
+	if (equal == 0) return 0.5 / stats->nhist;
+	return (float8) equal / stats->nhist;
 }
 
+// the selectivity of column OP nums[], where OP is one of the strategies
+float8 numsSel(intSetStats *stats, uint32 *nums, uint32 size, StrategyNumber strategy) {
+	float8 sel = 1.0, p = 0.0;
 
-// see if 2 trees are identical
-bool treeEqual(TreeNode a, TreeNode b) {
-    
-    if (a == NULL && b == NULL) return true;
-    else if (a == NULL && b != NULL) return false;
-    else if (a != NULL && b == NULL) return false;
-    if (a->data != b->data) return false;
-    else return treeEqual(a->left, b->left) && treeEqual(a->right, b->right);
+	switch (strategy) {
+		case INTSET_CONTAINS_STRATEGY:
+			// the row must have every element
+			if (!stats->hasMcelem) return (size == 0) ? 1.0 - stats->nullfrac : DEFAULT_CONTAIN_SEL;
+			for (uint32 i = 0; i < size; i++) sel *= elemFreq(stats, nums[i]);
+			break;
+		case INTSET_OVERLAP_STRATEGY:
+			// the row must have at least one element
+			if (!stats->hasMcelem) return (size == 0) ? 0.0 : DEFAULT_CONTAIN_SEL;
+			for (uint32 i = 0; i < size; i++) sel *= 1.0 - elemFreq(stats, nums[i]);
+			sel = 1.0 - sel;
+			break;
+		case INTSET_CONTAINED_STRATEGY:
+			/*
+				p is the chance that one element of a row is in nums[],
+				(the expected number of them over the average set size)
+				a row of c elements then is contained with chance p^c
+			*/
+			if (!stats->hasMcelem || !stats->hasDechist) return DEFAULT_CONTAIN_SEL;
+			if (stats->avgcount <= 0) return 1.0 - stats->nullfrac;
+			for (uint32 i = 0; i < size; i++) p += elemFreq(stats, nums[i]);
+			p = Min(1.0, p / stats->avgcount);
+			sel = 0.0;
+			for (uint32 i = 0; i < stats->nhist; i++) sel += pow(p, stats->dechist.numbers[i]);
+			sel /= stats->nhist;
+			break;
+		case INTSET_EQUAL_STRATEGY:
+			// the row must have the same size (and every element)
+			if (!stats->hasDechist) return 1.0;
+			sel = cardFreq(stats, size);
+			if (stats->hasMcelem) {
+				for (uint32 i = 0; i < size; i++) sel = Min(sel, elemFreq(stats, nums[i]));
+			}
+			break;
+		default:
+			elog(ERROR, "unrecognized strategy number: %d", strategy);
+	}
+	CLAMP_PROBABILITY(sel);
+	return sel * (1.0 - stats->nullfrac);
+}
+
+// the body of the join estimators, negate is for <>
+float8 joinSel(FunctionCallInfo fcinfo, StrategyNumber strategy, bool negate) {
+	PlannerInfo *root = (PlannerInfo *) PG_GETARG_POINTER(0);
+	Oid operator = PG_GETARG_OID(1);
+	List *args = (List *) PG_GETARG_POINTER(2);
+	SpecialJoinInfo *sjinfo = (SpecialJoinInfo *) PG_GETARG_POINTER(4);
+	VariableStatData vardata1, vardata2, *left, *right;
+	intSetStats stats1, stats2, *lstats, *rstats;
+	bool reversed;
+	float8 sel, eq, nonnull;
+
+	get_join_variables(root, args, sjinfo, &vardata1, &vardata2, &reversed);
+	loadStats(&vardata1, &stats1);
+	loadStats(&vardata2, &stats2);
+	// the operands in the order of the operator
+	left = reversed ? &vardata2 : &vardata1;
+	right = reversed ? &vardata1 : &vardata2;
+	lstats = reversed ? &stats2 : &stats1;
+	rstats = reversed ? &stats1 : &stats2;
+	nonnull = (1.0 - stats1.nullfrac) * (1.0 - stats2.nullfrac);
+
+	switch (strategy) {
+		case INTSET_HAS_STRATEGY:
+			// one side is the integer column and the other the sets
+			if (left->vartype == INT4OID) sel = hasJoinSel(left, rstats);
+			else sel = hasJoinSel(right, lstats);
+			break;
+		case INTSET_OVERLAP_STRATEGY:
+			sel = overlapJoinSel(lstats, rstats) * nonnull;
+			break;
+		case INTSET_CONTAINS_STRATEGY:
+			sel = containJoinSel(lstats, rstats) * nonnull;
+			break;
+		case INTSET_CONTAINED_STRATEGY:
+			sel = containJoinSel(rstats, lstats) * nonnull;
+			break;
+		case INTSET_EQUAL_STRATEGY:
+			// the most common values know better, but the two sets must have
+			// the same size too; for <> eqjoinsel matches them with =
+			sel = cardJoinFreq(lstats, rstats) * nonnull;
+			if (negate) operator = get_negator(operator);
+			if (OidIsValid(operator)) {
+				eq = DatumGetFloat8(DirectFunctionCall5(eqjoinsel, PG_GETARG_DATUM(0), ObjectIdGetDatum(operator),
+														PG_GETARG_DATUM(2), PG_GETARG_DATUM(3),
+														PG_GETARG_DATUM(4)));
+				sel = Min(sel, eq);
+			}
+			if (negate) sel = nonnull - sel;
+			break;
+		default:
+			elog(ERROR, "unrecognized strategy number: %d", strategy);
+	}
+
+	freeStats(&stats1);
+	freeStats(&stats2);
+	ReleaseVariableStats(vardata1);
+	ReleaseVariableStats(vardata2);
+	CLAMP_PROBABILITY(sel);
+	return sel;
+}
+
+// the selectivity of integer column ? set column: the chance that the
+// integer is each most common element times the frequency of that element,
+// and the rest of the integers meet the rest of the elements
+float8 hasJoinSel(VariableStatData *intdata, intSetStats *stats) {
+	AttStatsSlot mcv;
+	bool hasMcv = false, isdefault;
+	float8 intnull = 0.0, mcvsum = 0.0, other, nd, p, covered = 0.0, sel = 0.0;
+	int i;
+
+	if (!stats->hasMcelem) return DEFAULT_CONTAIN_SEL;
+	if (HeapTupleIsValid(intdata->statsTuple)) {
+		intnull = ((Form_pg_statistic) GETSTRUCT(intdata->statsTuple))->stanullfrac;
+		hasMcv = get_attstatsslot(&mcv, intdata->statsTuple, STATISTIC_KIND_MCV, InvalidOid,
+								  ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS);
+	}
+	if (hasMcv) {
+		for (i = 0; i < mcv.nnumbers; i++) mcvsum += mcv.numbers[i];
+	}
+	// the integers that are not most common values share the rest evenly
+	nd = get_variable_numdistinct(intdata, &isdefault) - (hasMcv ? mcv.nvalues : 0);
+	other = Max(0.0, 1.0 - intnull - mcvsum) / Max(1.0, nd);
+
+	for (uint32 j = 0; j < stats->nmce; j++) {
+		p = other;
+		for (i = 0; hasMcv && i < mcv.nvalues; i++) {
+			if (DatumGetUInt32(mcv.values[i]) == DatumGetUInt32(stats->mcelem.values[j])) {
+				p = mcv.numbers[i];
+				break;
+			}
+		}
+		sel += p * stats->mcelem.numbers[j];
+		covered += p;
+	}
+	// and the integers left meet elements that are not most common ones
+	sel += Max(0.0, 1.0 - intnull - covered) * stats->restfreq;
+
+	if (hasMcv) free_attstatsslot(&mcv);
+	return sel * (1.0 - stats->nullfrac);
+}
+
+// the chance that 2 sets overlap, from the expected number of elements they
+// share (the sum of the products of the frequencies of the most common
+// elements of either side) with the elements falling in independently
+float8 overlapJoinSel(intSetStats *a, intSetStats *b) {
+	float8 shared = 0.0;
+
+	if (!a->hasMcelem || !b->hasMcelem) return DEFAULT_CONTAIN_SEL;
+	for (uint32 i = 0; i < a->nmce; i++)
+		shared += a->mcelem.numbers[i] * elemFreq(b, DatumGetUInt32(a->mcelem.values[i]));
+	// the common ones are counted already
+	for (uint32 i = 0; i < b->nmce; i++) {
+		if (mceIndex(a, DatumGetUInt32(b->mcelem.values[i])) < 0)
+			shared += b->mcelem.numbers[i] * elemFreq(a, DatumGetUInt32(b->mcelem.values[i]));
+	}
+	return 1.0 - exp(-shared);
+}
+
+// the chance that a set of a contains a set of b: q is the chance that an
+// element of b is in a set of a (weighted by how common it is in b), so a
+// set of c elements of b is contained with chance q^c
+float8 containJoinSel(intSetStats *a, intSetStats *b) {
+	float8 num = 0.0, den = 0.0, q, sel = 0.0;
+
+	if (!a->hasMcelem || !b->hasMcelem || !b->hasDechist) return DEFAULT_CONTAIN_SEL;
+	for (uint32 i = 0; i < b->nmce; i++) {
+		num += b->mcelem.numbers[i] * elemFreq(a, DatumGetUInt32(b->mcelem.values[i]));
+		den += b->mcelem.numbers[i];
+	}
+	q = (den > 0) ? num / den : 0.0;
+	for (uint32 i = 0; i < b->nhist; i++) sel += pow(q, b->dechist.numbers[i]);
+	return sel / b->nhist;
+}
+
+// the chance that a set of a and a set of b have the same size
+float8 cardJoinFreq(intSetStats *a, intSetStats *b) {
+	float8 sel = 0.0;
+
+	if (!a->hasDechist || !b->hasDechist) return 1.0;
+	for (uint32 i = 0; i < a->nhist; i++) sel += cardFreq(b, (uint32) a->dechist.numbers[i]);
+	return sel / a->nhist;
+}
+
+// drops the elements that were seen too few times to be among the most
+// common ones by the end of the bucket (Lossy Counting)
+void pruneElements(HTAB *elements, int bucket) {
+	HASH_SEQ_STATUS scan;
+	elemTrack *item;
+
+	hash_seq_init(&scan, elements);
+	while ((item = (elemTrack *) hash_seq_search(&scan)) != NULL) {
+		if (item->frequency + item->delta <= bucket) {
+			if (hash_search(elements, &item->elem, HASH_REMOVE, NULL) == NULL)
+				elog(ERROR, "hash table corrupted");
+		}
+	}
 }
 
 /*
-    ---------------- helper functions ----------------
+    ---------------- Planner operations ----------------
 */
+// the arguments of a function or operator call
+List *callArgs(Node *node) {
+	if (IsA(node, FuncExpr)) return ((FuncExpr *) node)->args;
+	if (IsA(node, OpExpr)) return ((OpExpr *) node)->args;
+	return NIL;
+}
+
+// the cost of a call in units of cpu_operator_cost, which grows with the
+// total number of elements of the arguments as the class of the function says
+float8 callCost(PlannerInfo *root, Oid funcid, List *args) {
+	int growth = costGrowth(funcid);
+	Oid settype;
+	float8 n = 0.0;
+	ListCell *lc;
+
+	if (growth == COST_CONSTANT) return 1.0;
+
+	settype = setType(funcid);
+	foreach(lc, args) n += argSize(root, (Node *) lfirst(lc), settype);
+	if (growth == COST_SEARCH) return 1.0 + ELEMENT_COST * log2(n + 1.0);
+	return 1.0 + ELEMENT_COST * n;
+}
+
+// the COST_* class of a function, from costMemos once it has been looked up
+int costGrowth(Oid funcid) {
+	char *name;
+	int growth = COST_LINEAR, i;
+
+	for (i = 0; i < costMemoCount; i++) {
+		if (costMemos[i].funcid == funcid) return costMemos[i].growth;
+	}
+
+	name = get_func_name(funcid);
+	if (name != NULL) {
+		for (i = 0; costClasses[i].name != NULL; i++) {
+			if (strcmp(costClasses[i].name, name) == 0) break;
+		}
+		// anyone can attach intset_support to a function of their own
+		if (costClasses[i].name == NULL)
+			elog(DEBUG1, "intset: no cost class for function %s, costed as linear", name);
+		growth = costClasses[i].growth;
+		pfree(name);
+	}
+	// a full memo only means the name is looked up again next time
+	if (costMemoCount < COST_MEMO_SIZE) {
+		costMemos[costMemoCount].funcid = funcid;
+		costMemos[costMemoCount].growth = growth;
+		costMemoCount++;
+	}
+	return growth;
+}
+
+// the number of elements of an argument: exact for a constant, the average of
+// the column from its statistics otherwise; integers don't count. only a set
+// (of type settype) has our statistics, an array is sized from its width
+float8 argSize(PlannerInfo *root, Node *arg, Oid settype) {
+	VariableStatData vardata;
+	intSetStats stats;
+	float8 size = DEFAULT_SET_SIZE;
+	Const *c;
+
+	// sets and the integer arrays are the only variable length arguments
+	if (get_typlen(exprType(arg)) != -1) return 0.0;
+	if (IsA(arg, Const)) {
+		c = (Const *) arg;
+		if (c->constisnull) return 0.0;
+		// the raw size doesn't need the value to be detoasted
+		return (float8) (toast_raw_datum_size(c->constvalue) - VARHDRSZ) / 4;
+	}
+	if (root == NULL) return size;
+
+	examine_variable(root, arg, 0, &vardata);
+	if (exprType(arg) == settype)
+		loadStats(&vardata, &stats);
+	else
+		memset(&stats, 0, sizeof(intSetStats));
+	if (stats.hasDechist)
+		size = stats.avgcount;
+	else if (HeapTupleIsValid(vardata.statsTuple))
+		size = Max(0, ((Form_pg_statistic) GETSTRUCT(vardata.statsTuple))->stawidth - VARHDRSZ) / 4.0;
+	freeStats(&stats);
+	ReleaseVariableStats(vardata);
+	return size;
+}
+
+// the intset type, which is in the schema of the functions
+Oid setType(Oid funcid) {
+	return GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid, CStringGetDatum("intset"),
+						   ObjectIdGetDatum(get_func_namespace(funcid)));
+}
+
+// the index conditions a call of a set function can be answered with
+// by the index column its argument req->indexarg is on, NIL if none
+List *indexCondition(SupportRequestIndexCondition *req) {
+	char *name = get_func_name(req->funcid);
+	List *args = callArgs(req->node);
+	List *conds = NIL;
+
+	if (name == NULL) return NIL;
+	if (list_length(args) == 2) {
+		// a btree index on the integer of a call, not one on the set
+		if (req->index->relam == BTREE_AM_OID && exprType(list_nth(args, req->indexarg)) == INT4OID)
+			conds = spanIndexCondition(req, name, args);
+		else
+			conds = setIndexCondition(req, name, args);
+	}
+	pfree(name);
+	return conds;
+}
+
+// the call on an indexed set is the operator of the index with the set on its
+// left, if the opclass has that operator; the condition is then exact
+// (of a btree or hash opclass that is only =, under their own strategy number)
+List *setIndexCondition(SupportRequestIndexCondition *req, const char *name, List *args) {
+	Node *set = (Node *) list_nth(args, req->indexarg);
+	Node *other = (Node *) list_nth(args, 1 - req->indexarg);
+	Oid opno = InvalidOid;
+	StrategyNumber strategy;
+
+	for (int i = 0; indexOperators[i].name != NULL; i++) {
+		if (indexOperators[i].arg == req->indexarg && strcmp(indexOperators[i].name, name) == 0) {
+			strategy = indexOperators[i].strategy;
+			if (req->index->relam == BTREE_AM_OID || req->index->relam == HASH_AM_OID) {
+				if (strategy != INTSET_EQUAL_STRATEGY) break;
+				strategy = (req->index->relam == BTREE_AM_OID) ? BTEqualStrategyNumber : HTEqualStrategyNumber;
+			}
+			opno = get_opfamily_member(req->opfamily, exprType(set), exprType(other), strategy);
+			break;
+		}
+	}
+	if (!OidIsValid(opno) || !is_pseudo_constant_for_index(req->root, other, req->index)) return NIL;
+
+	req->lossy = false;
+	return list_make1(make_opclause(opno, BOOLOID, false, (Expr *) set, (Expr *) other,
+									InvalidOid, req->indexcollation));
+}
+
+// an integer in a constant set lies between the smallest and the largest
+// element of the set (as integers, see numsIntSpan), which a btree index on
+// the integer can scan; the call still has to be checked for the integers in
+// between
+List *spanIndexCondition(SupportRequestIndexCondition *req, const char *name, List *args) {
+	Node *num = (Node *) list_nth(args, req->indexarg);
+	Node *other = (Node *) list_nth(args, 1 - req->indexarg);
+	Const *c = (Const *) other;
+	intSet *a;
+	int32 min, max;
+	bool spanned;
+	Oid geop, leop;
+	Expr *lo, *hi;
+
+	if (!((req->indexarg == 0 && strcmp(name, "intset_contains") == 0) ||
+		  (req->indexarg == 1 && strcmp(name, "intset_has") == 0)))
+		return NIL;
+	if (exprType(num) != INT4OID || !IsA(other, Const) || c->constisnull) return NIL;
+	geop = get_opfamily_member(req->opfamily, INT4OID, INT4OID, BTGreaterEqualStrategyNumber);
+	leop = get_opfamily_member(req->opfamily, INT4OID, INT4OID, BTLessEqualStrategyNumber);
+	if (!OidIsValid(geop) || !OidIsValid(leop)) return NIL;
+
+	a = DatumGetIntSetP(c->constvalue);
+	spanned = numsIntSpan((uint32 *) VARDATA_ANY(a), VARSIZE_ANY_EXHDR(a) / 4, &min, &max);
+	if ((Pointer) a != DatumGetPointer(c->constvalue)) pfree(a);
+	// nothing is in the empty set, but that is for the call to find out
+	if (!spanned) return NIL;
+	lo = (Expr *) makeConst(INT4OID, -1, InvalidOid, sizeof(int32), Int32GetDatum(min), false, true);
+	hi = (Expr *) makeConst(INT4OID, -1, InvalidOid, sizeof(int32), Int32GetDatum(max), false, true);
+
+	req->lossy = true;
+	return list_make2(make_opclause(geop, BOOLOID, false, (Expr *) num, lo, InvalidOid, req->indexcollation),
+					  make_opclause(leop, BOOLOID, false, (Expr *) num, hi, InvalidOid, req->indexcollation));
+}
+
+// a simpler expression that a call of a set function (with its arguments
+// already simplified) gives the same result as, NULL if there is none
+Node *simplifyCall(PlannerInfo *root, FuncExpr *call) {
+	char *name = get_func_name(call->funcid);
+	Node *a, *b;
+	Node *ret = NULL;
+
+	if (name == NULL) return NULL;
+	if (strcmp(name, "intset_union") == 0 || strcmp(name, "intset_union_all") == 0) {
+		ret = simplifySetOperation(call, "intset_union", "intset_union_all", true);
+	} else if (strcmp(name, "intset_intersectn") == 0 || strcmp(name, "intset_intersect_all") == 0) {
+		ret = simplifySetOperation(call, "intset_intersectn", "intset_intersect_all", false);
+	} else if (list_length(call->args) == 2) {
+		a = (Node *) linitial(call->args);
+		b = (Node *) lsecond(call->args);
+		// A - {} and A !! {} are A, and so is {} !! A
+		// ({} - A and A && {} are not {}, as A may be NULL)
+		if (strcmp(name, "intset_diff") == 0 && isEmptySet(b)) ret = a;
+		else if (strcmp(name, "intset_disjunctn") == 0 && isEmptySet(b)) ret = a;
+		else if (strcmp(name, "intset_disjunctn") == 0 && isEmptySet(a)) ret = b;
+	}
+	pfree(name);
+	return ret;
+}
+
+// flattens a union (or an intersection) of unions (intersections) into one
+// call over all of their operands, with the constant ones combined into one
+// set; the empty set is left out of a union
+Node *simplifySetOperation(FuncExpr *call, const char *pairName, const char *allName, bool unite) {
+	Oid settype = call->funcresulttype;
+	Oid arraytype = get_array_type(settype);
+	Oid nsp = get_func_namespace(call->funcid);
+	Oid pairfunc = lookupSetFunction(nsp, pairName, settype, 2);
+	Oid allfunc = lookupSetFunction(nsp, allName, arraytype, 1);
+	List *operands, *vars = NIL;
+	intSet **sets;
+	intSet *merged;
+	int nsets = 0, before;
+	ListCell *lc;
+	ArrayExpr *arr;
+	FuncExpr *result;
+
+	if (!OidIsValid(pairfunc)) return NULL;
+	// a VARIADIC call with an array value has nothing to flatten
+	if (call->funcid == allfunc && !IsA(linitial(call->args), ArrayExpr)) return NULL;
+	before = call->funcid == allfunc ?
+		list_length(((ArrayExpr *) linitial(call->args))->elements) : list_length(call->args);
+
+	operands = setOperands((Node *) call, pairfunc, allfunc, NIL);
+	sets = (intSet **) palloc(list_length(operands) * sizeof(intSet *));
+	foreach(lc, operands) {
+		Node *op = (Node *) lfirst(lc);
+		if (IsA(op, Const) && !((Const *) op)->constisnull)
+			sets[nsets++] = DatumGetIntSetP(((Const *) op)->constvalue);
+		else
+			vars = lappend(vars, op);
+	}
+	if (nsets > 0) {
+		merged = unite ? setsUnion(sets, nsets) : setsIntersect(sets, nsets);
+		if (!unite || VARSIZE(merged) > VARHDRSZ || vars == NIL)
+			vars = lappend(vars, makeConst(settype, -1, InvalidOid, -1, PointerGetDatum(merged), false, false));
+	}
+
+	// nothing was flattened, combined or left out
+	if (list_length(operands) == before && list_length(vars) == before) return NULL;
+	if (list_length(vars) == 1) return (Node *) linitial(vars);
+	if (list_length(vars) == 2 && OidIsValid(pairfunc))
+		return (Node *) makeFuncExpr(pairfunc, settype, vars, InvalidOid, InvalidOid, COERCE_EXPLICIT_CALL);
+	if (!OidIsValid(allfunc) || !OidIsValid(arraytype)) return NULL;
+
+	arr = makeNode(ArrayExpr);
+	arr->array_typeid = arraytype;
+	arr->array_collid = InvalidOid;
+	arr->element_typeid = settype;
+	arr->elements = vars;
+	arr->multidims = false;
+	arr->location = -1;
+	result = makeFuncExpr(allfunc, settype, list_make1(arr), InvalidOid, InvalidOid, COERCE_EXPLICIT_CALL);
+	result->funcvariadic = true;
+	return (Node *) result;
+}
+
+// adds the conditions of pruneMembership to the quals (WHERE and JOIN ON) of a
+// query and of the queries in it
+void pruneQuery(Query *query) {
+	ListCell *lc;
+
+	foreach(lc, query->rtable) {
+		RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc);
+		if (rte->rtekind == RTE_SUBQUERY) pruneQuery(rte->subquery);
+	}
+	foreach(lc, query->cteList) pruneQuery((Query *) ((CommonTableExpr *) lfirst(lc))->ctequery);
+	query->jointree = (FromExpr *) pruneMutator((Node *) query->jointree, query);
+}
+
+// the expression tree mutator of pruneQuery, context is the query the tree
+// belongs to; the arguments are done first, so a call that has been rewritten
+// isn't looked at again
+Node *pruneMutator(Node *node, void *context) {
+	Node *ret;
+
+	if (node == NULL) return NULL;
+	// the subquery of a SubLink
+	if (IsA(node, Query)) {
+		pruneQuery((Query *) node);
+		return node;
+	}
+	node = expression_tree_mutator(node, pruneMutator, context);
+	if (IsA(node, FuncExpr) || IsA(node, OpExpr)) {
+		ret = pruneMembership((Query *) context, node);
+		if (ret != NULL) return ret;
+	}
+	return node;
+}
+
+// the partition pruner knows nothing about ?, so id ? S on a partitioned
+// table (id being an integer column and S the same for all rows) becomes
+//    id = ANY('{...}')		for a small constant S
+//    id >= min AND id <= max AND id ? S	for a larger constant S
+//    id >= intset_min(S) AND id <= intset_max(S) AND id ? S	otherwise
+// (min and max as integers, see numsIntSpan) which gives the same result,
+// NULLs included; the pruner uses the first two at plan time and the last
+// one at executor startup, for generic plans. the bounds are only there for
+// the pruner: they are cheaper than ? so they don't cost much to check, and
+// restrictSel leaves their selectivity out of that of ?. this is done by the planner
+// hook on the query as it was written, so each call is only rewritten once
+// (node is the call, in any of its forms), NULL if it isn't one
+Node *pruneMembership(Query *query, Node *node) {
+	List *args = callArgs(node);
+	Oid funcid;
+	Var *var;
+	Node *set;
+	RangeTblEntry *rte;
+	char *name;
+	int numarg;
+	List *conds;
+
+	if (list_length(args) != 2) return NULL;
+	// the integer column is the first argument of intset_contains and
+	// the second one of intset_has
+	numarg = IsA(linitial(args), Var) ? 0 : 1;
+	var = (Var *) list_nth(args, numarg);
+	set = (Node *) list_nth(args, 1 - numarg);
+	if (!IsA(var, Var) || var->varlevelsup != 0 || var->vartype != INT4OID) return NULL;
+	rte = rt_fetch(var->varno, query->rtable);
+	if (rte->rtekind != RTE_RELATION || rte->relkind != RELKIND_PARTITIONED_TABLE) return NULL;
+	if (contain_var_clause(set) || contain_volatile_functions(set)) return NULL;
+
+	if (IsA(node, OpExpr)) {
+		set_opfuncid((OpExpr *) node);
+		funcid = ((OpExpr *) node)->opfuncid;
+	} else {
+		funcid = ((FuncExpr *) node)->funcid;
+	}
+	name = get_func_name(funcid);
+	if (name == NULL) return NULL;
+	if (strcmp(name, numarg == 0 ? "intset_contains" : "intset_has") != 0) {
+		pfree(name);
+		return NULL;
+	}
+	pfree(name);
+
+	conds = pruneConditions(var, set, get_func_namespace(funcid));
+	if (conds == NIL) return NULL;
+	// = ANY of the elements of S is what id ? S means, so the call goes
+	if (IsA(linitial(conds), ScalarArrayOpExpr)) return (Node *) linitial(conds);
+	return (Node *) makeBoolExpr(AND_EXPR, lappend(conds, node), -1);
+}
+
+// the conditions on var that the elements of set give: = ANY of them for a
+// small constant set, the bounds of pruneBounds otherwise; NIL if none
+List *pruneConditions(Var *var, Node *set, Oid nsp) {
+	Const *c = (Const *) set;
+	intSet *a;
+	uint32 *anums;
+	uint32 asize;
+	Datum *elems;
+	ArrayType *arr;
+	ScalarArrayOpExpr *any;
+
+	if (!IsA(set, Const)) return pruneBounds(var, set, nsp);
+	if (c->constisnull) return NIL;
+	a = DatumGetIntSetP(c->constvalue);
+	anums = (uint32 *) VARDATA_ANY(a);
+	asize = VARSIZE_ANY_EXHDR(a) / 4;
+	if (asize == 0 || asize > PRUNE_ARRAY_SIZE) {
+		if ((Pointer) a != DatumGetPointer(c->constvalue)) pfree(a);
+		return (asize == 0) ? NIL : pruneBounds(var, set, nsp);
+	}
+
+	// the elements as the integers ? matches them with
+	elems = (Datum *) palloc(asize * sizeof(Datum));
+	for (uint32 i = 0; i < asize; i++) elems[i] = Int32GetDatum((int32) anums[i]);
+	arr = construct_array(elems, asize, INT4OID, sizeof(int32), true, 'i');
+	any = makeNode(ScalarArrayOpExpr);
+	any->opno = Int4EqualOperator;
+	any->opfuncid = F_INT4EQ;
+	any->useOr = true;
+	any->inputcollid = InvalidOid;
+	any->args = list_make2(copyObject(var),
+						   makeConst(INT4ARRAYOID, -1, InvalidOid, -1, PointerGetDatum(arr), false, false));
+	any->location = -1;
+	if ((Pointer) a != DatumGetPointer(c->constvalue)) pfree(a);
+	return list_make1(any);
+}
+
+// var >= min AND var <= max, min and max being the smallest and the largest
+// element of set as integers: constants for a constant set, calls of
+// intset_min and intset_max otherwise; NIL if there are none
+List *pruneBounds(Var *var, Node *set, Oid nsp) {
+	Const *c = (Const *) set;
+	intSet *a;
+	Oid settype = exprType(set);
+	Oid geop = get_opfamily_member(INTEGER_BTREE_FAM_OID, INT4OID, INT4OID, BTGreaterEqualStrategyNumber);
+	Oid leop = get_opfamily_member(INTEGER_BTREE_FAM_OID, INT4OID, INT4OID, BTLessEqualStrategyNumber);
+	Oid minfunc, maxfunc;
+	Expr *lo, *hi;
+	int32 min, max;
+	bool spanned;
+
+	if (!OidIsValid(geop) || !OidIsValid(leop)) return NIL;
+	if (IsA(set, Const)) {
+		if (c->constisnull) return NIL;
+		a = DatumGetIntSetP(c->constvalue);
+		spanned = numsIntSpan((uint32 *) VARDATA_ANY(a), VARSIZE_ANY_EXHDR(a) / 4, &min, &max);
+		if ((Pointer) a != DatumGetPointer(c->constvalue)) pfree(a);
+		if (!spanned) return NIL;
+		lo = (Expr *) makeConst(INT4OID, -1, InvalidOid, sizeof(int32), Int32GetDatum(min), false, true);
+		hi = (Expr *) makeConst(INT4OID, -1, InvalidOid, sizeof(int32), Int32GetDatum(max), false, true);
+	} else {
+		minfunc = lookupSetFunction(nsp, "intset_min", settype, 1);
+		maxfunc = lookupSetFunction(nsp, "intset_max", settype, 1);
+		if (!OidIsValid(minfunc) || !OidIsValid(maxfunc)) return NIL;
+		lo = (Expr *) makeFuncExpr(minfunc, INT4OID, list_make1(copyObject(set)), InvalidOid, InvalidOid,
+								   COERCE_EXPLICIT_CALL);
+		hi = (Expr *) makeFuncExpr(maxfunc, INT4OID, list_make1(copyObject(set)), InvalidOid, InvalidOid,
+								   COERCE_EXPLICIT_CALL);
+	}
+	return list_make2(make_opclause(geop, BOOLOID, false, (Expr *) copyObject(var), lo, InvalidOid, InvalidOid),
+					  make_opclause(leop, BOOLOID, false, (Expr *) copyObject(var), hi, InvalidOid, InvalidOid));
+}
+
+// appends the operands of a chain of calls of the pair function (as a
+// function or an operator) and the multi-way function to operands
+List *setOperands(Node *node, Oid pairfunc, Oid allfunc, List *operands) {
+	List *args;
+	ListCell *lc;
+
+	if (IsA(node, FuncExpr) && ((FuncExpr *) node)->funcid == pairfunc) {
+		args = ((FuncExpr *) node)->args;
+	} else if (IsA(node, OpExpr)) {
+		set_opfuncid((OpExpr *) node);
+		if (((OpExpr *) node)->opfuncid != pairfunc) return lappend(operands, node);
+		args = ((OpExpr *) node)->args;
+	} else if (IsA(node, FuncExpr) && ((FuncExpr *) node)->funcid == allfunc &&
+			   IsA(linitial(((FuncExpr *) node)->args), ArrayExpr)) {
+		args = ((ArrayExpr *) linitial(((FuncExpr *) node)->args))->elements;
+	} else {
+		return lappend(operands, node);
+	}
+	foreach(lc, args) operands = setOperands((Node *) lfirst(lc), pairfunc, allfunc, operands);
+	return operands;
+}
+
+// the function with the given name and argument type in the schema of the
+// set functions, InvalidOid if there is none
+Oid lookupSetFunction(Oid nsp, const char *name, Oid argtype, int nargs) {
+	Oid argtypes[2] = {argtype, argtype};
+	char *nspname = get_namespace_name(nsp);
+
+	if (nspname == NULL || !OidIsValid(argtype)) return InvalidOid;
+	return LookupFuncName(list_make2(makeString(nspname), makeString(pstrdup(name))),
+						  nargs, argtypes, true);
+}
+
+// is the clause "column ? set" (in any of its forms) for an integer column of
+// the relation and a set that is the same for all of its rows?
+bool probeClause(RelOptInfo *rel, RestrictInfo *rinfo, Var **var, Node **set) {
+	Node *clause = (Node *) rinfo->clause;
+	List *args = callArgs(clause);
+	Oid funcid;
+	char *name;
+	int numarg = -1;
+
+	if (list_length(args) != 2) return false;
+	if (IsA(clause, OpExpr)) {
+		set_opfuncid((OpExpr *) clause);
+		funcid = ((OpExpr *) clause)->opfuncid;
+	} else {
+		funcid = ((FuncExpr *) clause)->funcid;
+	}
+	name = get_func_name(funcid);
+	if (name == NULL) return false;
+	if (strcmp(name, "intset_contains") == 0) numarg = 0;
+	else if (strcmp(name, "intset_has") == 0) numarg = 1;
+	pfree(name);
+	if (numarg < 0) return false;
+
+	*var = (Var *) list_nth(args, numarg);
+	*set = (Node *) list_nth(args, 1 - numarg);
+	if (!IsA(*var, Var) || (*var)->varno != rel->relid || (*var)->varlevelsup != 0 ||
+		(*var)->vartype != INT4OID)
+		return false;
+	// the set is evaluated once per scan
+	return !contain_var_clause(*set) && !contain_volatile_functions(*set);
+}
+
+// the smallest btree index whose first column is the given integer column,
+// NULL if there is none
+IndexOptInfo *probeIndex(RelOptInfo *rel, Var *var) {
+	IndexOptInfo *best = NULL;
+	ListCell *lc;
+
+	foreach(lc, rel->indexlist) {
+		IndexOptInfo *index = (IndexOptInfo *) lfirst(lc);
+		if (index->relam != BTREE_AM_OID || !index->amhasgettuple) continue;
+		if (index->indexkeys[0] != var->varattno || index->opcintype[0] != INT4OID) continue;
+		if (index->indpred != NIL && !index->predOK) continue;
+		if (best == NULL || index->pages < best->pages) best = index;
+	}
+	return best;
+}
+
+// the cost of probing the index once per element: a descent to a leaf page
+// for each of them (neighbouring elements often share one), then a fetch
+// from the table for every match and the quals on it, as cost_index has it
+void probeCost(PlannerInfo *root, RelOptInfo *rel, RestrictInfo *rinfo, IndexOptInfo *index,
+			   Node *set, Path *path) {
+	float8 probes = Max(1.0, argSize(root, set, exprType(set)));
+	float8 descent = (ceil(log2(Max(index->tuples, 2.0))) + 50.0) * cpu_operator_cost;
+	float8 fetched = clamp_row_est(clause_selectivity(root, (Node *) rinfo, 0, JOIN_INNER, NULL) * rel->tuples);
+
+	path->startup_cost = rel->baserestrictcost.startup;
+	path->total_cost = path->startup_cost
+		+ Min(probes, (float8) index->pages) * random_page_cost
+		+ probes * descent
+		+ fetched * cpu_index_tuple_cost
+		+ Min(fetched, (float8) rel->pages) * random_page_cost
+		+ fetched * (cpu_tuple_cost + rel->baserestrictcost.per_tuple);
+}
+
+// evaluates the set and starts the index scan at its first element,
+// false if there are no elements to probe
+bool probeStart(intSetScanState *state) {
+	EState *estate = state->css.ss.ps.state;
+	ExprContext *econtext = state->css.ss.ps.ps_ExprContext;
+	MemoryContext old;
+	Datum value;
+	bool isnull;
+	uint32 size;
+
+	value = ExecEvalExprSwitchContext(state->setExpr, econtext, &isnull);
+	if (isnull) return false;
+	// the value only lives as long as the current row, the copy as the query
+	old = MemoryContextSwitchTo(estate->es_query_cxt);
+	state->set = (intSet *) PG_DETOAST_DATUM_COPY(value);
+	MemoryContextSwitchTo(old);
+	state->pos = 0;
+	size = VARSIZE_ANY_EXHDR(state->set) / 4;
+	if (size == 0) {
+		pfree(state->set);
+		state->set = NULL;
+		return false;
+	}
+	// the elements over PG_INT32_MAX are the negative integers, so the
+	// probes start there and wrap around to keep the rows in index order
+	state->wrap = lowerBound((uint32 *) VARDATA_ANY(state->set), size, (uint32) PG_INT32_MAX + 1) % size;
+
+	if (state->scan == NULL)
+		state->scan = index_beginscan(state->css.ss.ss_currentRelation, state->index,
+									  estate->es_snapshot, 1, 0);
+	ScanKeyInit(&state->key, 1, BTEqualStrategyNumber, F_INT4EQ, probeKey(state));
+	index_rescan(state->scan, &state->key, 1, NULL, 0);
+	return true;
+}
+
+// the integer the element being probed is matched with
+Datum probeKey(intSetScanState *state) {
+	uint32 size = VARSIZE_ANY_EXHDR(state->set) / 4;
+	return Int32GetDatum((int32) ((uint32 *) VARDATA_ANY(state->set))[(state->wrap + state->pos) % size]);
+}
+
+// is the expression the constant empty set?
+bool isEmptySet(Node *node) {
+	Const *c = (Const *) node;
+	if (!IsA(node, Const) || c->constisnull) return false;
+	return toast_raw_datum_size(c->constvalue) == VARHDRSZ;
+}
+
+
+
 /*
-    ---------------- Other operations ----------------
+    ---------------- Argument operations ----------------
 */
-int treeToArr(TreeNode root, uint32_t arr[], int i) {
+// a set argument of a call, detoasted; a constant or a parameter is
+// detoasted only once for all the calls of the expression
+intSet *argSet(FunctionCallInfo fcinfo, int argno) {
+	probeSet *p = probeArg(fcinfo, argno, false);
+	if (p != NULL) return p->set;
+	return PG_GETARG_INTSET_P(argno);
+}
 
-    if (root == NULL) return i;
-    if (root->left != NULL) i = treeToArr(root->left, arr, i);
-    arr[i] = root->data;
-    i++;
-    if (root->right != NULL) i = treeToArr(root->right, arr, i);
-    return i;
+// the prepared form of set argument argno (0 or 1) if it is a constant or a
+// parameter, NULL otherwise. a constant (as fn_expr tells) is prepared on the
+// first call and never looked at again; a parameter can change between calls
+// (on a rescan or as a PL/pgSQL variable), so it is made again when
+// probeStale() says so. a bitmap of the elements is added when asked for and
+// the set is dense enough for one
+probeSet *probeArg(FunctionCallInfo fcinfo, int argno, bool bitmap) {
+	FmgrInfo *flinfo = fcinfo->flinfo;
+	Pointer raw;
+	Size rawsize;
+	probeSet *p;
+	MemoryContext old;
+	uint32 *nums, size;
+	List *args;
+
+	if (argno > 1 || !get_fn_expr_arg_stable(flinfo, argno)) return NULL;
+	if (flinfo->fn_extra == NULL)
+		flinfo->fn_extra = MemoryContextAllocZero(flinfo->fn_mcxt, 2 * sizeof(probeSet));
+	p = &((probeSet *) flinfo->fn_extra)[argno];
+	// a constant is never looked at again once it is prepared
+	if (p->set == NULL || !p->isConst) {
+		raw = DatumGetPointer(PG_GETARG_DATUM(argno));
+		rawsize = VARSIZE_ANY(raw);
+		if (p->set == NULL || probeStale(p, raw, rawsize)) {
+			if (p->set != NULL) pfree(p->set);
+			if (p->raw != NULL) pfree(p->raw);
+			if (p->bitmap != NULL) pfree(p->bitmap);
+			args = callArgs(flinfo->fn_expr);
+			old = MemoryContextSwitchTo(flinfo->fn_mcxt);
+			p->set = (intSet *) PG_DETOAST_DATUM_COPY(PG_GETARG_DATUM(argno));
+			p->isConst = argno < list_length(args) && IsA(list_nth(args, argno), Const);
+			p->raw = NULL;
+			if (!p->isConst) {
+				p->raw = (Pointer) palloc(rawsize);
+				memcpy(p->raw, raw, rawsize);
+			}
+			MemoryContextSwitchTo(old);
+			p->rawptr = raw;
+			p->rawsize = rawsize;
+			p->sample = rawSample(raw, rawsize);
+			p->bitmapTried = false;
+			p->bitmap = NULL;
+		}
+	}
+
+	if (bitmap && !p->bitmapTried) {
+		p->bitmapTried = true;
+		nums = (uint32 *) VARDATA_ANY(p->set);
+		size = VARSIZE_ANY_EXHDR(p->set) / 4;
+		if (size > 0 && (uint64) nums[size - 1] - nums[0] < (uint64) size * BITMAP_DENSITY) {
+			p->min = nums[0];
+			p->nbits = nums[size - 1] - nums[0] + 1;
+			p->bitmap = (uint64 *) MemoryContextAllocZero(flinfo->fn_mcxt,
+														  ((p->nbits + 63) / 64) * sizeof(uint64));
+			for (uint32 i = 0; i < size; i++)
+				p->bitmap[(nums[i] - p->min) >> 6] |= UINT64CONST(1) << ((nums[i] - p->min) & 63);
+		}
+	}
+	return p;
 }
 
-// this func checks if a num exists in an array
-bool binarySearch(uint32 *n, uint32 low, uint32 high, uint32 target) {
-    if (high >= low) {
-		uint32 mid = low + (high - low) / 2;
-		if (n[mid] == target) return true;
-		if (n[mid] > target) return binarySearch(n, low, mid - 1, target);
-		return binarySearch(n, mid + 1, high, target);
+// has a parameter changed since its set was prepared? the same pointer, size
+// and sample is taken to be the same value, which is what the next call of
+// the same expression almost always gets; anything else is compared in full
+bool probeStale(probeSet *p, Pointer raw, Size rawsize) {
+	bool same;
+
+	if (p->rawsize != rawsize) return true;
+	if (raw == p->rawptr && rawSample(raw, rawsize) == p->sample) return false;
+	same = memcmp(p->raw, raw, rawsize) == 0;
+	if (same) {
+		p->rawptr = raw;
+		p->sample = rawSample(raw, rawsize);
 	}
-	return false;
+	return !same;
 }
 
-// given 2 sorted arrays of the same size, check if they r equal
-bool numsEqual(uint32 *a, uint32 *b, uint32 size) {
-	for (uint32_t i = 0; i < size; i++) {
-		if (a[i] != b[i]) return false;
+// a hash of RAW_SAMPLES words spread evenly over a datum (the last one
+// included), which tells most changes made in place apart
+uint32 rawSample(Pointer raw, Size rawsize) {
+	uint32 words = rawsize / 4, step, hash = 0, w;
+
+	if (words == 0) return 0;
+	step = Max(words / RAW_SAMPLES, 1);
+	for (uint32 i = 0; i < words; i += step) {
+		memcpy(&w, raw + i * 4, 4);
+		hash = ((hash << 5) | (hash >> 27)) ^ w;
 	}
-	return true;
-}
\ No newline at end of file
+	memcpy(&w, raw + (words - 1) * 4, 4);
+	return ((hash << 5) | (hash >> 27)) ^ w;
+}
+
+// is n an element of a prepared set?
+bool probeHas(probeSet *p, uint32 n) {
+	uint32 size = VARSIZE_ANY_EXHDR(p->set) / 4;
+
+	if (p->bitmap != NULL) {
+		if (n < p->min || n - p->min >= p->nbits) return false;
+		return (p->bitmap[(n - p->min) >> 6] >> ((n - p->min) & 63)) & 1;
+	}
+	return size > 0 && binarySearch((uint32 *) VARDATA_ANY(p->set), 0, size - 1, n);
+}
+
+// frees a set got from argSet() if it was detoasted for this call only;
+// the copy kept in fn_extra is left alone
+void argFree(FunctionCallInfo fcinfo, int argno, intSet *set) {
+	// a direct call (DirectFunctionCall2) has no flinfo, nor a cache
+	probeSet *cache = (fcinfo->flinfo != NULL) ? (probeSet *) fcinfo->flinfo->fn_extra : NULL;
+
+	if (argno <= 1 && cache != NULL && cache[argno].set == set) return;
+	PG_FREE_IF_COPY(set, argno);
+}
+
+// a set detoasted without a copy where it can be: one with a short header
+// is read where it is, unless its numbers would then be misaligned, and
+// only a compressed or out-of-line one has to be expanded
+intSet *detoastSet(Datum d) {
+	struct varlena *v = PG_DETOAST_DATUM_PACKED(d);
+
+	if (VARATT_IS_SHORT(v) && (uintptr_t) VARDATA_SHORT(v) % sizeof(uint32) != 0)
+		return (intSet *) PG_DETOAST_DATUM(PointerGetDatum(v));
+	return (intSet *) v;
+}
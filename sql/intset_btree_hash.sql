@@ -0,0 +1,85 @@
+--
+-- btree and hash operator classes (user-031, user-032)
+--
+-- sets are ordered as their element arrays are: {} < {1} < {1,2} < {2}
+--
+SELECT '{}'::intset < '{1}' AND '{1}'::intset < '{1,2}' AND '{1,2}'::intset < '{2}' AS ok;
+SELECT '{2}'::intset < '{4294967295}' AND '{1,4294967295}'::intset < '{2}' AS ok;
+SELECT intset_cmp('{1,2}', '{1,2}') = 0 AND '{1,2}'::intset <= '{1,2}' AND '{1,2}'::intset >= '{1,2}' AS ok;
+SELECT bool_and(sign(intset_cmp(a.s, b.s))
+                = CASE WHEN elems(a.s) < elems(b.s) THEN -1 WHEN elems(a.s) > elems(b.s) THEN 1 ELSE 0 END) AS ok
+   FROM sets a, sets b WHERE a.id BETWEEN 1 AND 200 AND b.id BETWEEN 1 AND 200;
+SELECT bool_and((a.s < b.s) = (intset_cmp(a.s, b.s) < 0) AND (a.s <= b.s) = (intset_cmp(a.s, b.s) <= 0)
+                AND (a.s > b.s) = (intset_cmp(a.s, b.s) > 0) AND (a.s >= b.s) = (intset_cmp(a.s, b.s) >= 0)
+                AND (a.s = b.s) = (intset_cmp(a.s, b.s) = 0)) AS ok
+   FROM sets a, sets b WHERE a.id BETWEEN 1 AND 200 AND b.id BETWEEN 1 AND 200;
+
+-- a sort (with sort support) puts the sets in the same order as
+-- intset_cmp, and as an index scan does
+SELECT bool_and(intset_cmp(p, s) <= 0) AS ok
+   FROM (SELECT s, lag(s) OVER (ORDER BY s) AS p FROM sets) t;
+CREATE TABLE sorted_sets AS SELECT id, row_number() OVER (ORDER BY s, id) AS n FROM sets;
+CREATE INDEX sets_btree ON sets (s, id);
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT plan_has('SELECT id FROM sets ORDER BY s, id', 'sets_btree') AS ok;
+SELECT array_agg(id) = (SELECT array_agg(id ORDER BY n) FROM sorted_sets) AS ok
+   FROM (SELECT id FROM sets ORDER BY s, id) t;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+-- btree index lookups, and = in function form
+SELECT index_matches_seq('SELECT id FROM sets WHERE s = ''{4294967291}''', 'sets_btree') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s = ''{}''', 'sets_btree') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s < ''{1}''', 'sets_btree') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s >= ''{500}''', 'sets_btree') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE intset_equal(s, (SELECT s FROM sets WHERE id = 46))', 'sets_btree') AS ok;
+DROP INDEX sets_btree;
+DROP TABLE sorted_sets;
+
+-- equal sets hash alike, and the extended hash with seed 0 has the
+-- plain hash in its low 32 bits
+SELECT intset_hash('{4294967291}') = intset_hash('{}'::intset + -5) AS ok;
+SELECT bool_and(intset_hash(a.s) = intset_hash(b.s)) AS ok
+   FROM sets a, sets b WHERE a.id BETWEEN 1 AND 200 AND b.id BETWEEN 1 AND 200 AND a.s = b.s;
+SELECT bool_and(intset_hash_extended(s, 0) & 4294967295 = intset_hash(s)::bigint & 4294967295) AS ok
+   FROM sets WHERE s IS NOT NULL;
+SELECT bool_and(intset_hash_extended(s, 1) <> intset_hash_extended(s, 0)) AS ok
+   FROM sets WHERE id BETWEEN 1 AND 100;
+
+-- hash aggregation and hash joins group the sets as sorting does
+SET enable_hashagg = off;
+CREATE TABLE grouped_sets AS SELECT s, count(*) AS n FROM sets GROUP BY s;
+RESET enable_hashagg;
+SET enable_sort = off;
+SELECT plan_has('SELECT s, count(*) FROM sets GROUP BY s', 'HashAggregate') AS ok;
+SELECT count(*) = (SELECT count(*) FROM grouped_sets) AS ok
+   FROM (SELECT s, count(*) AS n FROM sets GROUP BY s) h
+   JOIN grouped_sets g ON h.s IS NOT DISTINCT FROM g.s AND h.n = g.n;
+RESET enable_sort;
+SET enable_mergejoin = off;
+SET enable_nestloop = off;
+SELECT plan_has('SELECT a.id FROM sets a JOIN sets b ON a.s = b.s', 'Hash Join') AS ok;
+SELECT count(*) = (SELECT sum(n * n) FROM grouped_sets WHERE s IS NOT NULL) AS ok
+   FROM sets a JOIN sets b ON a.s = b.s;
+RESET enable_mergejoin;
+RESET enable_nestloop;
+DROP TABLE grouped_sets;
+
+-- hash indexes and hash partitions
+CREATE INDEX sets_hash ON sets USING hash (s);
+SELECT index_matches_seq('SELECT id FROM sets WHERE s = ''{4294967291}''', 'sets_hash') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s = (SELECT s FROM sets WHERE id = 46)', 'sets_hash') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE intset_equal(s, ''{}'')', 'sets_hash') AS ok;
+DROP INDEX sets_hash;
+CREATE TABLE hashed_sets (id integer, s intset) PARTITION BY HASH (s);
+CREATE TABLE hashed_sets_0 PARTITION OF hashed_sets FOR VALUES WITH (MODULUS 3, REMAINDER 0);
+CREATE TABLE hashed_sets_1 PARTITION OF hashed_sets FOR VALUES WITH (MODULUS 3, REMAINDER 1);
+CREATE TABLE hashed_sets_2 PARTITION OF hashed_sets FOR VALUES WITH (MODULUS 3, REMAINDER 2);
+INSERT INTO hashed_sets SELECT * FROM sets;
+SELECT count(*) = 3001 AS ok FROM hashed_sets;
+SELECT NOT plan_has('SELECT id FROM hashed_sets WHERE s = ''{4294967291}''', 'Append') AS ok;
+SELECT bool_and((SELECT array_agg(h.id ORDER BY h.id) FROM hashed_sets h WHERE h.s = t.s)
+                = (SELECT array_agg(o.id ORDER BY o.id) FROM sets o WHERE o.s = t.s)) AS ok
+   FROM sets t WHERE t.id BETWEEN 1 AND 100;
+DROP TABLE hashed_sets;
@@ -0,0 +1,71 @@
+--
+-- prepared arguments (user-049) and toasted sets (user-050)
+--
+-- a set that is the same for every row is prepared once per query; the
+-- results must not change when it changes between executions, for a
+-- parameter that keeps its size and for one that doesn't
+--
+SET plan_cache_mode = force_generic_plan;
+PREPARE overlap(intset) AS
+   SELECT bool_and((s ?| $1) = (elems(s) && elems($1))
+                   AND (s >@ $1) = (elems(s) @> elems($1))
+                   AND (s @< $1) = (elems(s) <@ elems($1))
+                   AND (s = $1) = (elems(s) = elems($1))) AS ok
+   FROM sets WHERE s IS NOT NULL;
+EXECUTE overlap('{1,2,3}');
+EXECUTE overlap('{4,5,6}');
+EXECUTE overlap('{4294967291,5,6}');
+EXECUTE overlap('{}');
+EXECUTE overlap('{4294967291}');
+EXECUTE overlap('{1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,4294967291}');
+DEALLOCATE overlap;
+PREPARE has(integer) AS
+   SELECT bool_and((s ? $1) = (u($1) = ANY(elems(s))) AND ($1 ? s) = (s ? $1)) AS ok
+   FROM sets WHERE s IS NOT NULL;
+EXECUTE has(7);
+EXECUTE has(-5);
+EXECUTE has(5000);
+DEALLOCATE has;
+RESET plan_cache_mode;
+
+-- a constant set, and one set per row against another
+SELECT bool_and((s ?| '{4294967291,17}') = (elems(s) && ARRAY[u(-5), 17])) AS ok
+   FROM sets WHERE s IS NOT NULL;
+SELECT bool_and((a.s ?| b.s) = (elems(a.s) && elems(b.s)) AND (a.s >@ b.s) = (elems(a.s) @> elems(b.s))) AS ok
+   FROM sets a, sets b WHERE a.id BETWEEN 1 AND 100 AND b.id BETWEEN 1 AND 100;
+SELECT bool_and((a.id ? b.s) = (u(a.id) = ANY(elems(b.s)))) AS ok
+   FROM sets a, sets b WHERE a.id BETWEEN 1 AND 100 AND b.id BETWEEN 1 AND 100;
+
+-- large sets stored with the default (extended) storage and out of line as
+-- they are, and a short one with a one byte header
+CREATE TABLE toasted (id integer, s intset);
+INSERT INTO toasted VALUES (1, intset_add_range('{}', -50000, 49999)),
+                           (2, intset_add_range('{}', -50000, 49999) - 7);
+ALTER TABLE toasted ALTER COLUMN s SET STORAGE external;
+INSERT INTO toasted VALUES (3, intset_add_range('{}', -50000, 49999)),
+                           (4, intset_add_range('{}', -50000, 49999) - 7),
+                           (5, '{7,4294967295}');
+SELECT count(*) = 5 AS ok FROM toasted;
+SELECT bool_and(# s = CASE id WHEN 5 THEN 2 WHEN 1 THEN 100000 WHEN 3 THEN 100000 ELSE 99999 END) AS ok
+   FROM toasted;
+SELECT bool_and(intset_min(s) = -50000 AND intset_max(s) = 49999) AS ok FROM toasted WHERE id < 5;
+SELECT intset_min(s) = -1 AND intset_max(s) = 7 AS ok FROM toasted WHERE id = 5;
+SELECT bool_and(s ? -50000 AND s ? -1 AND s ? 0 AND s ? 49999 AND NOT s ? 50000 AND NOT s ? -50001) AS ok
+   FROM toasted WHERE id < 5;
+SELECT bool_and((s ? 7) = (id IN (1, 3, 5))) AS ok FROM toasted;
+SELECT bool_and(intset_next(s, -1, 2)::text = '{0,1}' AND intset_prev(s, 0, 2)::text = '{4294967294,4294967295}') AS ok
+   FROM toasted WHERE id < 5;
+SELECT (SELECT string_agg(x::text, ',') FROM intset_elements(s, -2, 1) x) = '-2,-1,0,1' AS ok
+   FROM toasted WHERE id = 3;
+SELECT (SELECT count(*) FROM intset_elements(s)) = 100000 AS ok FROM toasted WHERE id = 3;
+SELECT a.s = b.s AND a.s <> c.s AND intset_cmp(a.s, c.s) <> 0 AND intset_hash(a.s) = intset_hash(b.s) AS ok
+   FROM toasted a, toasted b, toasted c WHERE a.id = 1 AND b.id = 3 AND c.id = 4;
+SELECT (a.s - b.s)::text = '{7}' AND (a.s && b.s) = b.s AND (a.s || b.s) = a.s AND (a.s !! b.s)::text = '{7}' AS ok
+   FROM toasted a, toasted b WHERE a.id = 3 AND b.id = 2;
+SELECT a.s >@ b.s AND b.s @< a.s AND NOT b.s >@ a.s AND a.s ?| b.s AND a.s >@ c.s AS ok
+   FROM toasted a, toasted b, toasted c WHERE a.id = 1 AND b.id = 4 AND c.id = 5;
+SELECT (s + 50000) ? 50000 AND NOT (s - 0) ? 0 AND # intset_remove_range(s, -49999, 49998) = 2 AS ok
+   FROM toasted WHERE id = 3;
+SELECT count(*) = 4 AS ok FROM toasted WHERE s ? -5;
+SELECT count(*) = 2 AS ok FROM toasted WHERE s ? 7 AND id < 5;
+DROP TABLE toasted;
@@ -0,0 +1,96 @@
+--
+-- GIN, GiST, BRIN and SP-GiST operator classes (user-033 to user-040, and
+-- the index conditions of user-045): every query gives the same rows with
+-- the index as without it, negative integers (elements over 2147483647)
+-- and ranges across 0 included. an int4range holds the elements from its
+-- lower bound (0 if that is negative) to its upper bound, and all of those
+-- over 2147483647 as well if it has no upper bound
+--
+
+-- GIN, one key per element (user-033, user-037)
+CREATE INDEX sets_gin ON sets USING gin (s);
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ? 7', 'sets_gin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ? -5', 'sets_gin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ? 5000', 'sets_gin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s >@ ''{4294967291,7}''', 'sets_gin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s >@ ''{}''', 'sets_gin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s @< (SELECT s FROM sets WHERE id = 44) + -5', 'sets_gin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s @< ''{}''', 'sets_gin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ?| ''{3,4294967000}''', 'sets_gin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s &&> int4range(-3, 3)', 'sets_gin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s &&> int4range(990, NULL)', 'sets_gin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s &&> int4range(NULL, -990)', 'sets_gin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE intset_contains(-5, s)', 'sets_gin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE intset_has(s, 7)', 'sets_gin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE intset_overlaps(s, ''{3,4294967000}'')', 'sets_gin') AS ok;
+SELECT bool_and((s &&> int4range(-3, 3)) = (elems(s) && ARRAY[0, 1, 2]::bigint[])) AS ok
+   FROM sets WHERE s IS NOT NULL;
+SELECT bool_and((s &&> int4range(990, NULL)) = (SELECT coalesce(bool_or(e >= 990), false) FROM unnest(elems(s)) e)) AS ok
+   FROM sets WHERE s IS NOT NULL;
+DROP INDEX sets_gin;
+
+-- GIN, one key per bucket of elements (user-038)
+CREATE INDEX sets_gin_bucket ON sets USING gin (s intset_gin_bucket_ops);
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ? 7', 'sets_gin_bucket') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ? -5', 'sets_gin_bucket') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s >@ ''{4294967291,7}''', 'sets_gin_bucket') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s @< (SELECT s FROM sets WHERE id = 44) + -5', 'sets_gin_bucket') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ?| ''{3,4294967000}''', 'sets_gin_bucket') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s &&> int4range(-3, 3)', 'sets_gin_bucket') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s &&> int4range(250, 260)', 'sets_gin_bucket') AS ok;
+DROP INDEX sets_gin_bucket;
+
+-- GiST signatures (user-034), nearest sets (user-035) and exclusion
+-- constraints (user-040)
+CREATE INDEX sets_gist ON sets USING gist (s);
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ? 7', 'sets_gist') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ? -5', 'sets_gist') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s >@ ''{4294967291,7}''', 'sets_gist') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s @< (SELECT s FROM sets WHERE id = 44) + -5', 'sets_gist') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ?| ''{3,4294967000}''', 'sets_gist') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s = (SELECT s FROM sets WHERE id = 46)', 'sets_gist') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s = ''{}''', 'sets_gist') AS ok;
+SELECT index_matches_seq('SELECT s <%> ''{4294967291,7,11,13}'' FROM sets ORDER BY s <%> ''{4294967291,7,11,13}'' LIMIT 20', 'sets_gist') AS ok;
+SELECT index_matches_seq('SELECT s <%> (SELECT s FROM sets WHERE id = 44) FROM sets ORDER BY s <%> (SELECT s FROM sets WHERE id = 44) LIMIT 5', 'sets_gist') AS ok;
+SELECT bool_and(abs((s <%> '{4294967291,7,11,13}')
+                    - (1 - (SELECT count(*) FROM unnest(elems(s)) e WHERE e IN (u(-5), 7, 11, 13))::float8
+                           / (SELECT count(*) FROM (SELECT unnest(elems(s)) UNION SELECT unnest(ARRAY[u(-5), 7, 11, 13])) t)))
+                < 1e-9) AS ok
+   FROM sets WHERE s IS NOT NULL;
+DROP INDEX sets_gist;
+CREATE TABLE disjoint_sets (id integer, s intset, EXCLUDE USING gist (s WITH ?|));
+INSERT INTO disjoint_sets VALUES (1, '{1,2,4294967295}'), (2, '{3,4}'), (3, '{}');
+INSERT INTO disjoint_sets VALUES (4, '{5}'::intset + -2);
+INSERT INTO disjoint_sets VALUES (5, '{3000000000}'::intset + -1);
+SELECT count(*) = 4 AS ok FROM disjoint_sets;
+SELECT count(*) = 0 AS ok FROM disjoint_sets a, disjoint_sets b WHERE a.id < b.id AND a.s ?| b.s;
+DROP TABLE disjoint_sets;
+
+-- BRIN (user-036)
+CREATE INDEX sets_brin ON sets USING brin (s) WITH (pages_per_range = 2);
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ? 7', 'sets_brin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ? -5', 'sets_brin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ? 5000', 'sets_brin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s >@ ''{4294967291,7}''', 'sets_brin') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s ?| ''{3,4294967000}''', 'sets_brin') AS ok;
+DROP INDEX sets_brin;
+
+-- SP-GiST over the [min, max] span of each set (user-039)
+CREATE INDEX sets_spgist ON sets USING spgist (s);
+SELECT index_matches_seq('SELECT id FROM sets WHERE s &&> int4range(-3, 3)', 'sets_spgist') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s <@ int4range(-900, 900)', 'sets_spgist') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s <@ int4range(0, NULL)', 'sets_spgist') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s <&> int4range(-1000, -990)', 'sets_spgist') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE s <&> int4range(2000, 3000)', 'sets_spgist') AS ok;
+SELECT bool_and((s <@ int4range(-900, 900)) = (SELECT coalesce(max(e) < 900, true) FROM unnest(elems(s)) e)) AS ok
+   FROM sets WHERE s IS NOT NULL;
+SELECT bool_and((s <&> int4range(-3, 3)) = (SELECT coalesce(min(e) < 3, false) FROM unnest(elems(s)) e)) AS ok
+   FROM sets WHERE s IS NOT NULL;
+DROP INDEX sets_spgist;
+
+-- membership of an integer column in a constant set, in function form,
+-- scans the span of the set in a btree index on the column (user-045)
+SET intset.enable_customscan = off;
+SELECT index_matches_seq('SELECT id FROM sets WHERE intset_contains(id, ''{4294967291,5,7}'')', 'sets_pkey') AS ok;
+SELECT index_matches_seq('SELECT id FROM sets WHERE intset_has(''{10,20,30}'', id)', 'sets_pkey') AS ok;
+RESET intset.enable_customscan;
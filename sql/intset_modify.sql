@@ -0,0 +1,69 @@
+--
+-- element and range mutations (user-028, user-029, user-030)
+--
+-- a negative integer is the element over 2147483647 that ? matches it with
+--
+
+-- + and -
+SELECT ('{1,2}'::intset + 3)::text = '{1,2,3}' AS ok;
+SELECT ('{1,2}'::intset + 2)::text = '{1,2}' AS ok;
+SELECT ('{}'::intset + 0)::text = '{0}' AS ok;
+SELECT ('{1,2}'::intset + -1)::text = '{1,2,4294967295}' AS ok;
+SELECT ('{1,2}'::intset + -2147483648)::text = '{1,2,2147483648}' AS ok;
+SELECT ('{1,2}'::intset + 2147483647)::text = '{1,2,2147483647}' AS ok;
+SELECT ('{1,2,4294967295}'::intset - -1)::text = '{1,2}' AS ok;
+SELECT ('{1,2,4294967295}'::intset - 2)::text = '{1,4294967295}' AS ok;
+SELECT ('{1,2}'::intset - 5)::text = '{1,2}' AS ok;
+SELECT ('{7}'::intset - 7)::text = '{}' AS ok;
+SELECT intset_add('{1}', -5) ? -5 AS ok;
+SELECT NOT intset_remove('{4294967291}', -5) ? -5 AS ok;
+
+-- whatever is added is then in the set, and gone once removed
+SELECT bool_and((s + x) ? x AND NOT (s - x) ? x) AS ok
+   FROM sets, generate_series(-3, 3) x WHERE s IS NOT NULL;
+SELECT bool_and(elems(s + x) = (SELECT array_agg(e ORDER BY e) FROM (SELECT unnest(elems(s)) UNION SELECT u(x)) t(e))) AS ok
+   FROM sets, generate_series(-3, 3) x WHERE s IS NOT NULL;
+
+-- intset_add_all and intset_remove_all
+SELECT intset_add_all('{1}', ARRAY[-1, 3, 3, -2147483648])::text = '{1,3,2147483648,4294967295}' AS ok;
+SELECT intset_add_all('{1}', '{}')::text = '{1}' AS ok;
+SELECT intset_add_all('{}', ARRAY[5, 4, 3])::text = '{3,4,5}' AS ok;
+SELECT intset_remove_all('{1,3,2147483648,4294967295}', ARRAY[-1, -2147483648, 7])::text = '{1,3}' AS ok;
+SELECT intset_remove_all('{1,3}', ARRAY[1, 3, 1])::text = '{}' AS ok;
+SELECT intset_remove_all('{1,3}', '{}')::text = '{1,3}' AS ok;
+
+-- the same as adding and removing one element at a time
+SELECT bool_and(intset_add_all(s, ARRAY[-3, 0, 3, -3]) = s + -3 + 0 + 3) AS ok
+   FROM sets WHERE s IS NOT NULL;
+SELECT bool_and(intset_remove_all(s, ARRAY[-5, 0, 5, 17]) = s - -5 - 0 - 5 - 17) AS ok
+   FROM sets WHERE s IS NOT NULL;
+SELECT bool_and(intset_add_all('{}', ARRAY(SELECT x FROM intset_elements(s) x)) = s) AS ok
+   FROM sets WHERE s IS NOT NULL;
+
+-- ranges on either side of 0, and across it
+SELECT intset_add_range('{1,9}', 3, 5)::text = '{1,3,4,5,9}' AS ok;
+SELECT intset_add_range('{1,9}', -2, 2)::text = '{0,1,2,9,4294967294,4294967295}' AS ok;
+SELECT intset_add_range('{1,9}', -3, -2)::text = '{1,9,4294967293,4294967294}' AS ok;
+SELECT intset_add_range('{}', 2147483646, 2147483647)::text = '{2147483646,2147483647}' AS ok;
+SELECT intset_add_range('{}', -2147483648, -2147483647)::text = '{2147483648,2147483649}' AS ok;
+SELECT intset_add_range('{1,9}', 5, 1)::text = '{1,9}' AS ok;
+SELECT intset_remove_range('{0,1,2,9,4294967294,4294967295}', -1, 1)::text = '{2,9,4294967294}' AS ok;
+SELECT intset_remove_range('{0,1,2,9,4294967294,4294967295}', -2, -1)::text = '{0,1,2,9}' AS ok;
+SELECT intset_remove_range('{0,1,2,9,4294967294,4294967295}', -2147483648, 2147483647)::text = '{}' AS ok;
+SELECT intset_remove_range('{1,9}', 5, 1)::text = '{1,9}' AS ok;
+SELECT intset_flip_range('{0,2,4294967295}', -2, 2)::text = '{1,4294967294}' AS ok;
+SELECT intset_flip_range('{0,2}', 0, 3)::text = '{1,3}' AS ok;
+SELECT intset_flip_range('{4294967295}', -1, -1)::text = '{}' AS ok;
+SELECT intset_flip_range('{1,9}', 5, 1)::text = '{1,9}' AS ok;
+
+-- the same as the elements of the range one by one
+SELECT intset_add_range('{}', -3, 3) = intset_add_all('{}', ARRAY(SELECT generate_series(-3, 3))) AS ok;
+SELECT bool_and(intset_add_range(s, -20, 20) = intset_add_all(s, ARRAY(SELECT generate_series(-20, 20)))) AS ok
+   FROM sets WHERE s IS NOT NULL;
+SELECT bool_and(intset_remove_range(s, -20, 20) = intset_remove_all(s, ARRAY(SELECT generate_series(-20, 20)))) AS ok
+   FROM sets WHERE s IS NOT NULL;
+SELECT bool_and(intset_flip_range(s, -20, 20)
+                = intset_remove_range(s, -20, 20) || (intset_add_range('{}', -20, 20) - s)) AS ok
+   FROM sets WHERE s IS NOT NULL;
+SELECT bool_and(intset_flip_range(intset_flip_range(s, -500, 500), -500, 500) = s) AS ok
+   FROM sets WHERE s IS NOT NULL;
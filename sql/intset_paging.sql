@@ -0,0 +1,78 @@
+--
+-- intset_next, intset_prev and intset_elements (user-026, user-027)
+--
+-- elements over 2147483647 are the negative integers, so in integer order
+-- {1,5,9,3000000000,4294967295} is -1294967296, -1, 1, 5, 9
+--
+
+-- the next elements after a cursor
+SELECT intset_next('{1,5,9,3000000000,4294967295}', 1, 2)::text = '{5,9}' AS ok;
+SELECT intset_next('{1,5,9,3000000000,4294967295}', -1294967296, 2)::text = '{1,4294967295}' AS ok;
+SELECT intset_next('{1,5,9,3000000000,4294967295}', -2000000000, 3)::text = '{1,3000000000,4294967295}' AS ok;
+SELECT intset_next('{1,5,9,3000000000,4294967295}', -1, 10)::text = '{1,5,9}' AS ok;
+SELECT intset_next('{1,5,9,3000000000,4294967295}', 9, 2)::text = '{}' AS ok;
+SELECT intset_next('{}', 0, 2)::text = '{}' AS ok;
+
+-- and the previous ones before it
+SELECT intset_prev('{1,5,9,3000000000,4294967295}', 1, 2)::text = '{3000000000,4294967295}' AS ok;
+SELECT intset_prev('{1,5,9,3000000000,4294967295}', 5, 2)::text = '{1,4294967295}' AS ok;
+SELECT intset_prev('{1,5,9,3000000000,4294967295}', 0, 1)::text = '{4294967295}' AS ok;
+SELECT intset_prev('{1,5,9,3000000000,4294967295}', -1294967296, 1)::text = '{}' AS ok;
+SELECT intset_prev('{1,5,9,3000000000,4294967295}', 100, 10)::text = '{1,5,9,3000000000,4294967295}' AS ok;
+
+-- paging through a set two elements at a time, from the smallest integer
+-- up and from the largest down, gives all of it in integer order
+WITH RECURSIVE page(n, p) AS (
+   SELECT 1, intset_next('{1,5,9,3000000000,4294967295}', -2147483648, 2)
+   UNION ALL
+   SELECT n + 1, intset_next('{1,5,9,3000000000,4294967295}', intset_max(p), 2)
+   FROM page WHERE # p > 0
+)
+SELECT string_agg(x::text, ',' ORDER BY n, x) = '-1294967296,-1,1,5,9' AS ok
+   FROM page, LATERAL intset_elements(p) x;
+WITH RECURSIVE page(n, p) AS (
+   SELECT 1, intset_prev('{1,5,9,3000000000,4294967295}', 2147483647, 2)
+   UNION ALL
+   SELECT n + 1, intset_prev('{1,5,9,3000000000,4294967295}', intset_min(p), 2)
+   FROM page WHERE # p > 0
+)
+SELECT string_agg(x::text, ',' ORDER BY n DESC, x) = '-1294967296,-1,1,5,9' AS ok
+   FROM page, LATERAL intset_elements(p) x;
+
+-- every set of the table, paged from either end
+SELECT bool_and(intset_next(s, -2147483648, 3) = intset_add_all('{}', (SELECT array_agg(x) FROM (SELECT x FROM intset_elements(s) x LIMIT 3) t))) AS ok
+   FROM sets WHERE # s > 0;
+SELECT bool_and(intset_prev(s, 2147483647, 3) = intset_add_all('{}', (SELECT array_agg(x) FROM (SELECT x FROM intset_elements(s) x ORDER BY x DESC LIMIT 3) t))) AS ok
+   FROM sets WHERE # s > 0;
+
+-- the elements, in integer order
+SELECT string_agg(x::text || ':' || n, ',') = '-1294967296:1,-1:2,1:3,5:4,9:5' AS ok
+   FROM intset_elements('{1,5,9,3000000000,4294967295}') WITH ORDINALITY AS e(x, n);
+SELECT string_agg(x::text, ',') = '-1294967296,-1,1' AS ok
+   FROM intset_elements('{1,4294967295}'::intset + -1294967296);
+SELECT count(*) = 0 AS ok FROM intset_elements('{}');
+
+-- the elements within bounds, on either side of 0 or across it
+SELECT string_agg(x::text, ',') = '-1,1,5' AS ok
+   FROM intset_elements('{1,5,9,3000000000,4294967295}', -1, 5);
+SELECT string_agg(x::text, ',') = '-1294967296,-1' AS ok
+   FROM intset_elements('{1,5,9,3000000000,4294967295}', -2000000000, 0);
+SELECT string_agg(x::text, ',') = '9' AS ok
+   FROM intset_elements('{1,5,9,3000000000,4294967295}', 6, 2147483647);
+SELECT string_agg(x::text, ',') = '-1294967296,-1,1,5,9' AS ok
+   FROM intset_elements('{1,5,9,3000000000,4294967295}', -2147483648, 2147483647);
+SELECT count(*) = 0 AS ok
+   FROM intset_elements('{1,5,9,3000000000,4294967295}', 5, 1);
+SELECT count(*) = 0 AS ok
+   FROM intset_elements('{1,5,9,3000000000,4294967295}', 2, 4);
+
+-- for every set of the table, the elements are those of its text form, in
+-- integer order, and the bounded form returns the ones within the bounds
+SELECT bool_and((SELECT array_agg(u(x) ORDER BY u(x)) FROM intset_elements(s) x) = elems(s)) AS ok
+   FROM sets WHERE # s > 0;
+SELECT bool_and((SELECT array_agg(x) FROM intset_elements(s) x)
+                = (SELECT array_agg(x ORDER BY x) FROM intset_elements(s) x)) AS ok
+   FROM sets WHERE # s > 0;
+SELECT bool_and((SELECT coalesce(array_agg(x), '{}') FROM intset_elements(s, -300, 300) x)
+                = (SELECT coalesce(array_agg(x), '{}') FROM intset_elements(s) x WHERE x BETWEEN -300 AND 300)) AS ok
+   FROM sets WHERE s IS NOT NULL;
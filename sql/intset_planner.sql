@@ -0,0 +1,98 @@
+--
+-- planner support (user-044 to user-048)
+--
+-- the planner hooks are only there once the library is loaded
+LOAD '/srvr/z5261524/postgresql-12.5/src/tutorial/intset';
+
+-- intset_elements returns a row per element, and a call costs more the
+-- more elements it is given (user-044)
+SELECT estimated_rows('SELECT * FROM intset_elements(''{1,2,3,4,5}'')') = 5 AS ok;
+SELECT estimated_rows('SELECT * FROM intset_elements(intset_add_range(''{}'', -500, 499))') = 1000 AS ok;
+SELECT estimated_rows('SELECT * FROM intset_elements(''{}'')') = 1 AS ok;
+SELECT estimated_rows('SELECT x FROM sets, intset_elements(s) x') BETWEEN 3001 * 5 AND 3001 * 20 AS ok;
+SELECT estimated_cost('SELECT s ?| intset_add_range(''{}'', 1, 100000) FROM sets')
+       > estimated_cost('SELECT s ?| ''{1}'' FROM sets') AS ok;
+SELECT estimated_cost('SELECT s || intset_add_range(''{}'', -50000, 49999) FROM sets')
+       > estimated_cost('SELECT s || ''{1}'' FROM sets') AS ok;
+
+-- algebraic simplification (user-046)
+SELECT plan_has('SELECT id, s - ''{}''::intset FROM sets', 'Output: id, s$') AS ok;
+SELECT plan_has('SELECT id, s !! ''{}''::intset FROM sets', 'Output: id, s$') AS ok;
+SELECT plan_has('SELECT id, ''{}''::intset !! s FROM sets', 'Output: id, s$') AS ok;
+SELECT plan_has('SELECT id, s || ''{}''::intset FROM sets', 'Output: id, s$') AS ok;
+SELECT NOT plan_has('SELECT id, s && ''{}''::intset FROM sets', 'Output: id, s$') AS ok;
+SELECT NOT plan_has('SELECT id, s || ''{1}''::intset || ''{4294967295}''::intset FROM sets', '\{1\}')
+       AND plan_has('SELECT id, s || ''{1}''::intset || ''{4294967295}''::intset FROM sets', '\{1,4294967295\}') AS ok;
+SELECT bool_and((s || '{1}'::intset || '{4294967295}'::intset) = (s || '{1,4294967295}'::intset)
+                AND (s && '{1,2,3}'::intset && s) = (s && '{1,2,3}'::intset)
+                AND (s - '{}'::intset) = s AND ('{}'::intset !! s) = s) AS ok
+   FROM sets WHERE s IS NOT NULL;
+SELECT count(*) = 1 AS ok FROM sets WHERE id = 0 AND (s - '{}'::intset) IS NULL AND (s && '{}'::intset) IS NULL;
+
+-- index probes for integer ? set (user-047), negative integers included
+CREATE TABLE keyed AS SELECT i AS id FROM generate_series(-2000, 2000) i;
+ALTER TABLE keyed ADD PRIMARY KEY (id);
+ANALYZE keyed;
+SELECT sorted_rows('SELECT id FROM keyed WHERE id ? ''{3,1500,4294967291,4294967295}''') = '{-5,-1,3,1500}' AS ok;
+SELECT sorted_rows('SELECT id FROM keyed WHERE ''{3,1500,4294967291,4294967295}'' ? id') = '{-5,-1,3,1500}' AS ok;
+SELECT sorted_rows('SELECT id FROM keyed WHERE intset_contains(id, ''{3,1500,4294967291,4294967295}'')') = '{-5,-1,3,1500}' AS ok;
+SELECT sorted_rows('SELECT id FROM keyed WHERE id ? ''{3000,3000000000}''') = '{}' AS ok;
+SELECT index_matches_seq('SELECT id FROM keyed WHERE id ? ''{3,1500,4294967291,4294967295}''', 'IntSet Index Probe') AS ok;
+SELECT index_matches_seq('SELECT id FROM keyed WHERE ''{3,1500,4294967291,4294967295}'' ? id', 'IntSet Index Probe') AS ok;
+SELECT index_matches_seq('SELECT id FROM keyed WHERE id ? ''{}''', 'IntSet Index Probe') AS ok;
+SET intset.enable_customscan = off;
+SELECT NOT plan_has('SELECT id FROM keyed WHERE id ? ''{3,1500,4294967291,4294967295}''', 'IntSet Index Probe') AS ok;
+RESET intset.enable_customscan;
+SET plan_cache_mode = force_generic_plan;
+PREPARE probe(intset, text) AS
+   SELECT coalesce(array_agg(id ORDER BY id)::text, '{}') = $2 AS ok FROM keyed WHERE id ? $1;
+SELECT plan_has('EXECUTE probe(''{1}'', '''')', 'IntSet Index Probe') AS ok;
+EXECUTE probe('{3,1500,4294967291,4294967295}', '{-5,-1,3,1500}');
+EXECUTE probe('{2147483648,2147483647}', '{}');
+EXECUTE probe('{}', '{}');
+DEALLOCATE probe;
+RESET plan_cache_mode;
+DROP TABLE keyed;
+
+-- partition pruning for integer ? set (user-048): the partitions that can't
+-- hold an element of the set are left out, those of negative integers
+-- included
+CREATE TABLE parted (id integer) PARTITION BY RANGE (id);
+CREATE TABLE parted_neg PARTITION OF parted FOR VALUES FROM (MINVALUE) TO (0);
+CREATE TABLE parted_low PARTITION OF parted FOR VALUES FROM (0) TO (1000);
+CREATE TABLE parted_high PARTITION OF parted FOR VALUES FROM (1000) TO (MAXVALUE);
+INSERT INTO parted SELECT generate_series(-2000, 2000);
+ANALYZE parted;
+SELECT sorted_rows('SELECT id FROM parted WHERE id ? ''{5,4294967291}''') = '{-5,5}'
+       AND plan_has('SELECT id FROM parted WHERE id ? ''{5,4294967291}''', 'parted_neg')
+       AND plan_has('SELECT id FROM parted WHERE id ? ''{5,4294967291}''', 'parted_low')
+       AND NOT plan_has('SELECT id FROM parted WHERE id ? ''{5,4294967291}''', 'parted_high') AS ok;
+SELECT sorted_rows('SELECT id FROM parted WHERE ''{4294967291}'' ? id') = '{-5}'
+       AND NOT plan_has('SELECT id FROM parted WHERE ''{4294967291}'' ? id', 'parted_low|parted_high') AS ok;
+SELECT sorted_rows('SELECT id FROM parted WHERE intset_contains(id, ''{1500}'')') = '{1500}'
+       AND NOT plan_has('SELECT id FROM parted WHERE intset_contains(id, ''{1500}'')', 'parted_neg|parted_low') AS ok;
+SELECT sorted_rows('SELECT id FROM parted WHERE id ? intset_add_range(''{}'', -100, 100)')
+       = (SELECT array_agg(i)::text FROM generate_series(-100, 100) i)
+       AND NOT plan_has('SELECT id FROM parted WHERE id ? intset_add_range(''{}'', -100, 100)', 'parted_high') AS ok;
+SELECT sorted_rows('SELECT id FROM parted WHERE id ? intset_add_range(''{}'', 10, 500)')
+       = (SELECT array_agg(i)::text FROM generate_series(10, 500) i)
+       AND NOT plan_has('SELECT id FROM parted WHERE id ? intset_add_range(''{}'', 10, 500)', 'parted_neg|parted_high') AS ok;
+SELECT sorted_rows('SELECT id FROM parted WHERE id ? NULL::intset') = '{}' AS ok;
+SELECT sorted_rows('SELECT id FROM parted WHERE id ? ''{}''') = '{}' AS ok;
+SELECT sorted_rows('SELECT id FROM parted WHERE NOT id ? ''{5,4294967291}'' AND id BETWEEN -6 AND 6')
+       = '{-6,-4,-3,-2,-1,0,1,2,3,4,6}' AS ok;
+SELECT sorted_rows('WITH c AS MATERIALIZED (SELECT id FROM parted WHERE id ? ''{1500}'') SELECT id FROM c') = '{1500}'
+       AND NOT plan_has('WITH c AS MATERIALIZED (SELECT id FROM parted WHERE id ? ''{1500}'') SELECT id FROM c', 'parted_neg|parted_low') AS ok;
+SELECT sorted_rows('SELECT 1 FROM sets WHERE id = 1 AND EXISTS (SELECT 1 FROM parted WHERE id ? ''{1500}'')') = '{1}'
+       AND NOT plan_has('SELECT 1 FROM sets WHERE id = 1 AND EXISTS (SELECT 1 FROM parted WHERE id ? ''{1500}'')', 'parted_neg|parted_low') AS ok;
+SET plan_cache_mode = force_generic_plan;
+PREPARE pruned(intset, text) AS
+   SELECT coalesce(array_agg(id ORDER BY id)::text, '{}') = $2 AS ok FROM parted WHERE id ? $1;
+SELECT plan_has('EXECUTE pruned(''{4294967291,4294967295}'', '''')', 'Subplans Removed: 2')
+       AND NOT plan_has('EXECUTE pruned(''{4294967291,4294967295}'', '''')', 'parted_low|parted_high') AS ok;
+EXECUTE pruned('{4294967291,4294967295}', '{-5,-1}');
+EXECUTE pruned('{4294967291,4294967295,1500}', '{-5,-1,1500}');
+EXECUTE pruned('{}', '{}');
+DEALLOCATE pruned;
+RESET plan_cache_mode;
+DROP TABLE parted;
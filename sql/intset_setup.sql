@@ -0,0 +1,111 @@
+--
+-- regression tests for intset, run from this directory (after the library
+-- is built and installed where intset.source expects it) with
+--    pg_regress --inputdir=. intset_setup intset_paging intset_modify \
+--       intset_btree_hash intset_index intset_stats intset_planner intset_cache
+--
+-- intset_setup creates the type and what the other tests share: the sets
+-- table and a few helpers. elems() turns a set into an array of its elements
+-- (as bigints, 0 to 4294967295) from its text form, to check the operators
+-- against array ones; u() is the element an integer stands for.
+--
+\set ECHO none
+SET client_min_messages = warning;
+\i intset.source
+RESET client_min_messages;
+\set ECHO all
+
+CREATE FUNCTION elems(intset) RETURNS bigint[]
+   AS $$ SELECT string_to_array(trim(both '{}' from $1::text), ',')::bigint[] $$
+   LANGUAGE SQL IMMUTABLE STRICT;
+
+CREATE FUNCTION u(integer) RETURNS bigint
+   AS $$ SELECT $1::bigint & 4294967295 $$
+   LANGUAGE SQL IMMUTABLE STRICT;
+
+-- true if a line of the plan of q matches the regular expression pat
+CREATE FUNCTION plan_has(q text, pat text) RETURNS bool AS $$
+DECLARE
+   line text;
+BEGIN
+   FOR line IN EXECUTE 'EXPLAIN (VERBOSE, COSTS OFF) ' || q LOOP
+      IF line ~ pat THEN
+         RETURN true;
+      END IF;
+   END LOOP;
+   RETURN false;
+END
+$$ LANGUAGE plpgsql;
+
+-- the planner's row and cost estimates for q
+CREATE FUNCTION estimated_rows(q text) RETURNS float8 AS $$
+DECLARE
+   plan json;
+BEGIN
+   EXECUTE 'EXPLAIN (FORMAT JSON) ' || q INTO plan;
+   RETURN (plan->0->'Plan'->>'Plan Rows')::float8;
+END
+$$ LANGUAGE plpgsql;
+
+CREATE FUNCTION estimated_cost(q text) RETURNS float8 AS $$
+DECLARE
+   plan json;
+BEGIN
+   EXECUTE 'EXPLAIN (FORMAT JSON) ' || q INTO plan;
+   RETURN (plan->0->'Plan'->>'Total Cost')::float8;
+END
+$$ LANGUAGE plpgsql;
+
+-- the rows of the one column query q, sorted, as text
+CREATE FUNCTION sorted_rows(q text) RETURNS text AS $$
+DECLARE
+   res text;
+BEGIN
+   EXECUTE 'SELECT array_agg(x ORDER BY x)::text FROM (' || q || ') t(x)' INTO res;
+   RETURN coalesce(res, '{}');
+END
+$$ LANGUAGE plpgsql;
+
+-- true if q gives the same rows with a sequential scan as it does with a
+-- plan that uses idx (which it must); the scans other than the sequential
+-- one are as they were set for the second plan
+CREATE FUNCTION index_matches_seq(q text, idx text) RETURNS bool AS $$
+DECLARE
+   scans text[] := ARRAY['enable_indexscan', 'enable_indexonlyscan',
+                         'enable_bitmapscan', 'intset.enable_customscan'];
+   saved text[];
+   seq text;
+BEGIN
+   FOR i IN 1 .. array_length(scans, 1) LOOP
+      saved[i] := coalesce(current_setting(scans[i], true), 'on');
+      PERFORM set_config(scans[i], 'off', true);
+   END LOOP;
+   PERFORM set_config('enable_seqscan', 'on', true);
+   seq := sorted_rows(q);
+   FOR i IN 1 .. array_length(scans, 1) LOOP
+      PERFORM set_config(scans[i], saved[i], true);
+   END LOOP;
+   PERFORM set_config('enable_seqscan', 'off', true);
+   IF NOT plan_has(q, idx) THEN
+      RAISE NOTICE 'no % in the plan of %', idx, q;
+      RETURN false;
+   END IF;
+   RETURN sorted_rows(q) = seq;
+END
+$$ LANGUAGE plpgsql;
+
+-- 3000 sets of up to 22 elements in [-1000, 999] (so that about half of
+-- each set is over 2147483647), every other one with -5 in it, and a NULL
+CREATE TABLE sets (id integer PRIMARY KEY, s intset);
+INSERT INTO sets
+   SELECT i, intset_add_all('{}'::intset,
+                            ARRAY(SELECT (i * 37 + k * 101) % 2000 - 1000
+                                  FROM generate_series(1, i % 23) k)
+                            || CASE WHEN i % 2 = 0 THEN ARRAY[-5] ELSE '{}'::integer[] END)
+   FROM generate_series(1, 3000) i;
+INSERT INTO sets VALUES (0, NULL);
+
+SELECT count(*) = 3001 AS ok FROM sets;
+SELECT bool_and(elems(s) <@ (SELECT array_agg(u(x)) FROM generate_series(-1000, 999) x)) AS ok
+   FROM sets;
+SELECT bool_and(u(-5) = ANY(elems(s))) AS ok FROM sets WHERE id % 2 = 0 AND id > 0;
@@ -0,0 +1,40 @@
+--
+-- element statistics and the selectivity estimators (user-041 to user-043)
+--
+-- the estimates are only checked to be in the right range, every other
+-- set of the table has -5 in it (the element 4294967291)
+--
+
+-- without statistics the estimators fall back on defaults
+CREATE TABLE unanalyzed_sets (s intset);
+SELECT estimated_rows('SELECT * FROM unanalyzed_sets WHERE s ? 7') > 0 AS ok;
+SELECT estimated_rows('SELECT * FROM unanalyzed_sets WHERE s >@ ''{1,2}''') > 0 AS ok;
+SELECT estimated_rows('SELECT * FROM unanalyzed_sets a JOIN unanalyzed_sets b ON a.s ?| b.s') > 0 AS ok;
+DROP TABLE unanalyzed_sets;
+
+-- the most common elements are kept as the integers ? matches them with,
+-- along with a histogram of the set sizes
+ANALYZE sets;
+SELECT -5 = ANY(most_common_elems::text::integer[]) AS ok
+   FROM pg_stats WHERE tablename = 'sets' AND attname = 's';
+SELECT NOT 4294967291 = ANY(most_common_elems::text::bigint[]) AS ok
+   FROM pg_stats WHERE tablename = 'sets' AND attname = 's';
+SELECT elem_count_histogram IS NOT NULL AS ok
+   FROM pg_stats WHERE tablename = 'sets' AND attname = 's';
+
+-- restriction estimates
+SELECT estimated_rows('SELECT * FROM sets WHERE s ? -5') BETWEEN 1200 AND 1800 AS ok;
+SELECT estimated_rows('SELECT * FROM sets WHERE -5 ? s') BETWEEN 1200 AND 1800 AS ok;
+SELECT estimated_rows('SELECT * FROM sets WHERE s >@ ''{4294967291}''') BETWEEN 1200 AND 1800 AS ok;
+SELECT estimated_rows('SELECT * FROM sets WHERE s ?| ''{4294967291}''') BETWEEN 1200 AND 1800 AS ok;
+SELECT estimated_rows('SELECT * FROM sets WHERE s ? 5000') < 50 AS ok;
+SELECT estimated_rows('SELECT * FROM sets WHERE s >@ ''{4294967291,5000}''') < 50 AS ok;
+SELECT estimated_rows('SELECT * FROM sets WHERE s = ''{}''') < 300 AS ok;
+SELECT estimated_rows('SELECT * FROM sets WHERE s <> ''{}''') > 2500 AS ok;
+
+-- join estimates
+SELECT estimated_rows('SELECT * FROM sets a JOIN sets b ON a.s ?| b.s')
+       BETWEEN 3001 * 3001 * 0.1 AND 3001 * 3001 AS ok;
+SELECT estimated_rows('SELECT * FROM sets a JOIN sets b ON a.s = b.s') BETWEEN 1000 AND 1000000 AS ok;
+SELECT estimated_rows('SELECT * FROM sets a JOIN sets b ON a.s <> b.s') > 3001 * 3001 * 0.5 AS ok;
+SELECT estimated_rows('SELECT * FROM sets a JOIN sets b ON a.s >@ b.s') < 3001 * 3001 AS ok;